@@ -0,0 +1,79 @@
+#!/usr/bin/python3
+"""
+Measures how long `LOAD textplot` takes while the telemetry endpoint is slow to answer.
+
+A local stand-in endpoint accepts the telemetry request and holds it for a few seconds before answering, like a
+host without network access waiting for a connection to time out. LOAD must not wait for it.
+
+Usage: benchmark/textplot/load_time.py [--duckdb build/release/duckdb]
+                                       [--extension build/release/extension/textplot/textplot.duckdb_extension]
+                                       [--runs 20] [--delay 5]
+"""
+
+import argparse
+import http.server
+import os
+import re
+import statistics
+import subprocess
+import sys
+import threading
+
+
+class SlowHandler(http.server.BaseHTTPRequestHandler):
+    delay = 5.0
+    stop = threading.Event()
+
+    def do_POST(self):
+        self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        SlowHandler.stop.wait(SlowHandler.delay)
+        self.send_response(204)
+        self.end_headers()
+
+    def log_message(self, format, *args):
+        pass
+
+
+def load_seconds(duckdb: str, extension: str, env: dict) -> float:
+    """Runs LOAD in a fresh process and returns the run time of the statement as reported by .timer."""
+    output = subprocess.run(
+        [duckdb, "-unsigned", ":memory:", "-c", ".timer on", "-c", f"LOAD '{extension}'"],
+        env=env,
+        check=True,
+        capture_output=True,
+        text=True,
+    ).stdout
+    match = re.search(r"Run Time \(s\): real ([0-9.]+)", output)
+    if match is None:
+        sys.exit(f"no timing in duckdb output:\n{output}")
+    return float(match.group(1))
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--duckdb", default="build/release/duckdb")
+    parser.add_argument("--extension", default="build/release/extension/textplot/textplot.duckdb_extension")
+    parser.add_argument("--runs", type=int, default=20)
+    parser.add_argument("--delay", type=float, default=5.0, help="seconds the endpoint holds each request")
+    args = parser.parse_args()
+
+    SlowHandler.delay = args.delay
+    server = http.server.ThreadingHTTPServer(("127.0.0.1", 0), SlowHandler)
+    server.daemon_threads = True
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+
+    env = dict(os.environ)
+    env.pop("QUERY_FARM_TELEMETRY_OPT_OUT", None)
+    env["QUERY_FARM_TELEMETRY_URL"] = f"http://127.0.0.1:{server.server_address[1]}/"
+    opt_out_env = dict(env, QUERY_FARM_TELEMETRY_OPT_OUT="1")
+
+    for name, run_env in (("telemetry opted out", opt_out_env), ("slow telemetry endpoint", env)):
+        times = [load_seconds(args.duckdb, args.extension, run_env) * 1000 for _ in range(args.runs)]
+        print(f"{name:<25} median {statistics.median(times):8.2f} ms  max {max(times):8.2f} ms")
+
+    SlowHandler.stop.set()
+    server.shutdown()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,137 @@
+#!/usr/bin/python3
+"""
+Runs the benchmarks of benchmark/textplot with DuckDB's benchmark runner at 1, 4 and all threads and compares the
+median timings with the baseline committed in benchmark/textplot/baseline. The baseline is only meaningful on the
+machine it was recorded on, which is stored next to it in machine.txt. Without a complete baseline, or with
+benchmarks it has no timing for, the comparison fails instead of passing.
+
+Usage: scripts/run-benchmarks.py [--pattern 'benchmark/textplot/.*'] [--update-baseline]
+
+The runner is built by `BUILD_BENCHMARK=1 make release`, `make benchmark` builds and runs it.
+"""
+
+import argparse
+import csv
+import os
+import platform
+import statistics
+import subprocess
+import sys
+import tempfile
+
+RUNNER = "build/release/benchmark/benchmark_runner"
+BASELINE_DIR = "benchmark/textplot/baseline"
+# Slower than the baseline by more than this is reported as a regression
+REGRESSION_RATIO = 1.10
+
+
+def run(runner: str, pattern: str, threads: int) -> dict:
+    """Returns the median timing in seconds of every benchmark matching 'pattern'."""
+    with tempfile.NamedTemporaryFile(suffix=".csv") as out:
+        subprocess.run([runner, pattern, f"--threads={threads}", f"--out={out.name}"], check=True)
+        timings = {}
+        with open(out.name) as f:
+            for row in csv.reader(f, delimiter="\t"):
+                if len(row) != 3 or row[0] == "name":
+                    continue
+                timings.setdefault(row[0], []).append(float(row[2]))
+    return {name: statistics.median(values) for name, values in timings.items()}
+
+
+def machine_description() -> str:
+    """CPU model, core count and OS of this machine."""
+    cpu = platform.processor() or platform.machine()
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    cpu = line.split(":", 1)[1].strip()
+                    break
+    except OSError:
+        pass
+    return f"{cpu}, {os.cpu_count()} cores, {platform.system()} {platform.release()}"
+
+
+def machine_path() -> str:
+    return os.path.join(BASELINE_DIR, "machine.txt")
+
+
+def baseline_path(threads_name: str) -> str:
+    return os.path.join(BASELINE_DIR, f"threads_{threads_name}.csv")
+
+
+def read_baseline(path: str) -> dict:
+    if not os.path.exists(path):
+        return {}
+    with open(path) as f:
+        return {row["name"]: float(row["median"]) for row in csv.DictReader(f)}
+
+
+def write_baseline(path: str, medians: dict) -> None:
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "w", newline="") as f:
+        writer = csv.writer(f, lineterminator="\n")
+        writer.writerow(["name", "median"])
+        for name in sorted(medians):
+            writer.writerow([name, f"{medians[name]:.6f}"])
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--runner", default=RUNNER)
+    parser.add_argument("--pattern", default="benchmark/textplot/.*")
+    parser.add_argument("--update-baseline", action="store_true", help="write the timings as the new baseline")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.runner):
+        sys.exit(f"{args.runner} not found, build it with BUILD_BENCHMARK=1 make release")
+
+    machine = machine_description()
+    thread_counts = (("1", 1), ("4", 4), ("all", os.cpu_count()))
+    if args.update_baseline:
+        os.makedirs(BASELINE_DIR, exist_ok=True)
+        with open(machine_path(), "w") as f:
+            f.write(machine + "\n")
+    else:
+        missing = [path for path in [machine_path()] + [baseline_path(name) for name, _ in thread_counts]
+                   if not os.path.exists(path)]
+        if missing:
+            sys.exit(f"No baseline to compare with, {', '.join(missing)} missing. Record it with "
+                     "`make benchmark_baseline` on the benchmark machine and commit it.")
+        with open(machine_path()) as f:
+            recorded_on = f.read().strip()
+        print(f"Baseline recorded on: {recorded_on}")
+        if recorded_on != machine:
+            print(f"Running on:           {machine}, the ratios are not comparable")
+
+    regressions = 0
+    unbaselined = 0
+    # 'all' is the runner's default, one thread per core
+    for threads_name, threads in thread_counts:
+        medians = run(args.runner, args.pattern, threads)
+        path = baseline_path(threads_name)
+        if args.update_baseline:
+            write_baseline(path, medians)
+            continue
+        baseline = read_baseline(path)
+        print(f"\n{threads_name} thread(s):")
+        for name in sorted(medians):
+            line = f"  {name:<60} {medians[name]:9.4f}s"
+            if name in baseline:
+                ratio = medians[name] / baseline[name]
+                line += f"  {ratio:6.2f}x baseline"
+                if ratio > REGRESSION_RATIO:
+                    line += "  REGRESSION"
+                    regressions += 1
+            else:
+                line += "  NOT IN BASELINE"
+                unbaselined += 1
+            print(line)
+
+    if regressions or unbaselined:
+        sys.exit(f"{regressions} benchmark(s) slower than the baseline, {unbaselined} without a baseline timing, "
+                 "record new benchmarks with `make benchmark_baseline`")
+
+
+if __name__ == "__main__":
+    main()
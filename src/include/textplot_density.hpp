@@ -3,15 +3,80 @@
 #include "duckdb.hpp"
 #include "duckdb/function/scalar_function.hpp"
 #include "duckdb/common/exception.hpp"
+#include "duckdb/function/aggregate_function.hpp"
+#include "textplot_scale.hpp"
 #include <unordered_map>
 #include <vector>
 
 namespace duckdb {
 
+// Density plot bind data structure, shared by tp_density and tp_density_agg
+struct TextplotDensityBindData : public FunctionData {
+	int64_t width = 20;
+	std::vector<std::string> density_chars;
+	string marker_char;
+	// Optional fixed histogram range, values outside of it are not counted
+	TextplotScaleBound min;
+	TextplotScaleBound max;
+	// Kernel density smoothing, a bandwidth of 0 picks one from the data
+	bool smooth = false;
+	double bandwidth = 0;
+	// Elements sampled from each list, 0 reads all of them
+	idx_t max_samples = 0;
+
+	TextplotDensityBindData(int64_t width_p, std::vector<std::string> density_chars_p, string marker_char_p,
+	                        TextplotScaleBound min_p, TextplotScaleBound max_p, bool smooth_p, double bandwidth_p,
+	                        idx_t max_samples_p)
+	    : width(width_p), density_chars(std::move(density_chars_p)), marker_char(std::move(marker_char_p)),
+	      min(min_p), max(max_p), smooth(smooth_p), bandwidth(bandwidth_p), max_samples(max_samples_p) {
+	}
+
+	unique_ptr<FunctionData> Copy() const override {
+		return make_uniq<TextplotDensityBindData>(width, density_chars, marker_char, min, max, smooth, bandwidth,
+		                                          max_samples);
+	}
+	bool Equals(const FunctionData &other_p) const override {
+		const auto &other = other_p.Cast<TextplotDensityBindData>();
+		return width == other.width && density_chars == other.density_chars && marker_char == other.marker_char &&
+		       min == other.min && max == other.max && smooth == other.smooth && bandwidth == other.bandwidth &&
+		       max_samples == other.max_samples;
+	}
+};
+
+// Bins counted per plot character when smoothing
+static constexpr idx_t TEXTPLOT_SMOOTH_OVERSAMPLE = 8;
+
+// Binds the optional arguments (width, style, graph_chars, marker, min, max, smooth, approx, max_samples)
+// starting at 'first_option'.
+// Per-row min/max columns are only accepted if 'allow_row_bounds' is set.
+unique_ptr<TextplotDensityBindData> TextplotDensityBindOptions(ClientContext &context, const string &function_name,
+                                                               vector<unique_ptr<Expression>> &arguments,
+                                                               idx_t first_option, bool allow_row_bounds);
+
+// The characters of a density style, from empty to full. Throws a BinderException for unknown styles.
+const std::vector<std::string> &TextplotDensityStyle(const string &function_name, const string &style);
+
+// Renders a plot where every value is the same
+string TextplotRenderDensityConstant(const TextplotDensityBindData &bind_data);
+
+// Renders bind_data.width histogram bins, scaled to the fullest bin
+string TextplotRenderDensityBins(const TextplotDensityBindData &bind_data, const vector<idx_t> &bins,
+                                 int64_t marker_pos = -1);
+string TextplotRenderDensityBins(const TextplotDensityBindData &bind_data, const vector<double> &bins,
+                                 int64_t marker_pos = -1);
+
+// Smooths bind_data.width * TEXTPLOT_SMOOTH_OVERSAMPLE bins covering a range 'range' wide with a Gaussian
+// kernel and renders them
+string TextplotRenderDensitySmoothed(const TextplotDensityBindData &bind_data, const vector<idx_t> &fine_bins,
+                                     double range);
+
 // Function declarations
 unique_ptr<FunctionData> TextplotDensityBind(ClientContext &context, ScalarFunction &bound_function,
                                              vector<unique_ptr<Expression>> &arguments);
 
 void TextplotDensity(DataChunk &args, ExpressionState &state, Vector &result);
 
+// tp_density_agg(value, ...): streaming aggregate form of tp_density
+AggregateFunction TextplotDensityAggFunction();
+
 } // namespace duckdb
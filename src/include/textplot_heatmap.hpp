@@ -0,0 +1,11 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/function/aggregate_function.hpp"
+
+namespace duckdb {
+
+// tp_heatmap(x, y, ...): 2D density aggregate rendered as a multi-line string with the density styles
+AggregateFunction TextplotHeatmapAggFunction();
+
+} // namespace duckdb
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <vector>
+
+namespace duckdb {
+
+// Bounded-size streaming histogram used by the tp_*_agg aggregates.
+//
+// With a fixed range it counts directly into the requested bins, values outside of the range are ignored.
+// Without one it keeps the first PENDING_CAPACITY values exactly, after that they are counted into
+// RESOLUTION equal-width bins whose range doubles whenever a value falls outside of it. Either way the
+// state never grows beyond a few kilobytes, regardless of the number of values added.
+class TextplotHistogram {
+public:
+	static constexpr idx_t RESOLUTION = 1024;
+	static constexpr idx_t PENDING_CAPACITY = RESOLUTION;
+
+	TextplotHistogram() = default;
+	// Fixed range histogram with 'bin_count' bins over [range_min, range_max]
+	TextplotHistogram(double range_min, double range_max, idx_t bin_count);
+
+	void Add(double value);
+	void Combine(const TextplotHistogram &other);
+
+	// Number of values counted
+	idx_t Count() const {
+		return count;
+	}
+	double Min() const {
+		return min;
+	}
+	double Max() const {
+		return max;
+	}
+	bool IsFixed() const {
+		return fixed;
+	}
+
+	// Counts the values into bins.size() equal-width bins over [range_min, range_max], clamping to the
+	// first and last bin like tp_density does. Exact for fixed range and pending values, otherwise each
+	// internal bin is split across the output bins it overlaps.
+	void Bin(double range_min, double range_max, vector<idx_t> &bins) const;
+
+	// Spreads 'n' values over the positions [first, last) of 'bins', in units of bins, assuming they are spread
+	// evenly. Positions are clamped to the bins, no value is lost to rounding. Only the bins from the clamped
+	// 'first' to the clamped 'last' are touched.
+	static void SpreadCount(double first, double last, idx_t n, vector<idx_t> &bins);
+
+private:
+	void BuildGrid();
+	void AddToGrid(double value, idx_t n);
+	void Grow(bool downward);
+	idx_t GridIndex(double value) const;
+
+	bool fixed = false;
+	idx_t count = 0;
+	double min = 0;
+	double max = 0;
+
+	// Exact values, only used until the adaptive grid is built
+	vector<double> pending;
+
+	// Bin counts, either the fixed bins or the adaptive grid
+	vector<idx_t> counts;
+	double lo = 0;
+	double hi = 0;
+	double bin_width = 0;
+};
+
+} // namespace duckdb
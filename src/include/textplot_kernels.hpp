@@ -0,0 +1,47 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+// Plain loops over fixed-size lanes and blocks, written so that the compiler vectorizes them
+// for whatever instruction set the extension is built for.
+
+struct TextplotExtent {
+	double min;
+	double max;
+	// Number of values within the requested bounds
+	idx_t count;
+};
+
+// Finds the minimum and maximum of the values within [lower, upper] in a single pass.
+// NaN is never within bounds.
+TextplotExtent TextplotExtentKernel(const double *data, idx_t count, double lower, double upper);
+
+// Adds the values within [range_min, range_max] to bins.size() equal-width bins over that range,
+// the maximum lands in the last bin. Values outside of the range and NaN are skipped.
+// 'scratch' holds the sub-histograms and is reused between calls.
+void TextplotBinKernel(const double *data, idx_t count, double range_min, double range_max, vector<idx_t> &bins,
+                       vector<idx_t> &scratch);
+
+// Changes between neighbouring sparkline values smaller than this are drawn as no change
+static constexpr double TEXTPLOT_CHANGE_EPSILON = 1e-10;
+
+// Averages the values of 'width' consecutive buckets into 'means' and finds the extent of all values, in a
+// single pass. Bucket i starts at value floor(i * size / width) and holds at least one value. size > 0.
+// NaN is not counted in the extent.
+TextplotExtent TextplotBucketMeanKernel(const double *data, idx_t size, idx_t width, double *means);
+
+// Maps each value to round((value - min) / (max - min) * max_level), clamped to [0, max_level]. max > min.
+void TextplotLevelKernel(const double *values, idx_t count, double min, double max, int32_t max_level,
+                         int32_t *levels);
+
+// Writes the size - 1 absolute changes between neighbouring values to 'magnitudes', changes within
+// TEXTPLOT_CHANGE_EPSILON and NaN as 0. Returns the number of those, which sort before all other changes.
+idx_t TextplotChangeMagnitudeKernel(const double *data, idx_t size, double *magnitudes);
+
+// Classifies the change sampled for each of 'width' cells, data[j + 1] - data[j] with j = floor(i * (size - 1) /
+// width): 0 large fall, 1 fall, 2 no change, 3 rise, 4 large rise, where large means above 'threshold'. size > 1.
+void TextplotChangeLevelKernel(const double *data, idx_t size, idx_t width, double threshold, int32_t *levels);
+
+} // namespace duckdb
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/types/vector.hpp"
+#include "duckdb/function/scalar_function.hpp"
+#include "duckdb/execution/expression_executor_state.hpp"
+#include "textplot_render.hpp"
+
+namespace duckdb {
+
+// Lets the numeric list argument at 'index' through without a cast when TextplotListReader reads its
+// element type natively, other numeric lists are still cast to LIST(DOUBLE).
+void TextplotBindNumericList(ScalarFunction &bound_function, const vector<unique_ptr<Expression>> &arguments,
+                             idx_t index);
+
+// The type TextplotListReader reads a LIST or ARRAY of numbers as: a LIST of the element type when it is read
+// natively, LIST(DOUBLE) otherwise. INVALID if 'type' is not a list of numbers.
+LogicalType TextplotNumericListType(const LogicalType &type);
+
+// Elements read per row with 'approx := true'
+static constexpr idx_t TEXTPLOT_DEFAULT_MAX_SAMPLES = 100000;
+
+// Binds the 'approx' and 'max_samples' options into 'max_samples', 0 meaning exact. Returns false if 'alias'
+// is neither option.
+bool TextplotBindSampling(ClientContext &context, const string &function_name, const string &alias,
+                          Expression &arg, idx_t &max_samples);
+
+// Per thread scratch of the functions that read lists, kept from chunk to chunk so that once the buffers have
+// grown to the longest list rows are plotted without allocating.
+struct TextplotListLocalState : public FunctionLocalState {
+	// Converted or sampled list elements, see TextplotListReader
+	vector<double> elements;
+	// Histogram bins and smoothing buffers of tp_density, bucket means and change magnitudes of tp_sparkline
+	vector<idx_t> bins;
+	vector<idx_t> histograms;
+	vector<double> work;
+	vector<double> work_other;
+	// Glyph index of every character of a sparkline
+	vector<int32_t> levels;
+	// The series of a multi-series tp_sparkline row one after another, series i spans
+	// series_bounds[i] to series_bounds[i + 1], and their labels
+	vector<double> series;
+	vector<idx_t> series_bounds;
+	vector<string_t> labels;
+	// The plot of the current row
+	TextplotRender output;
+
+	static unique_ptr<FunctionLocalState> Init(ExpressionState &state, const BoundFunctionExpression &expr,
+	                                           FunctionData *bind_data);
+	static TextplotListLocalState &Get(ExpressionState &state);
+};
+
+// Reads the rows of a numeric list vector as doubles. Flat DOUBLE lists without NULL elements are read in
+// place, other rows are converted into 'scratch', which is reused from row to row. NULL elements are left out.
+class TextplotListReader {
+public:
+	TextplotListReader(Vector &list_vector, idx_t count, vector<double> &scratch);
+
+	bool RowIsValid(idx_t row) const {
+		return list_format.validity.RowIsValid(list_format.sel->get_index(row));
+	}
+
+	// The non-NULL elements of a valid row, the pointer is valid until the next call
+	const double *GetRow(idx_t row, idx_t &length);
+
+	// Like GetRow, but rows longer than 'max_samples' are sampled: the row is split into 'max_samples' equal
+	// strata and one element is taken from each, in list order. With 'jitter' the element is at a fixed
+	// pseudo-random position within its stratum, otherwise at its center. 0 reads the whole row.
+	const double *GetSample(idx_t row, idx_t max_samples, bool jitter, idx_t &length);
+
+private:
+	typedef void (*convert_row_t)(const UnifiedVectorFormat &format, const list_entry_t &entry, double divisor,
+	                              vector<double> &result);
+	typedef void (*sample_row_t)(const UnifiedVectorFormat &format, const list_entry_t &entry, double divisor,
+	                             idx_t max_samples, bool jitter, vector<double> &result);
+
+	template <class T>
+	void SetElementType();
+
+	UnifiedVectorFormat list_format;
+	const list_entry_t *entries;
+	UnifiedVectorFormat child_format;
+	bool in_place = false;
+	convert_row_t convert_row = nullptr;
+	sample_row_t sample_row = nullptr;
+	// Scale of DECIMAL elements
+	double divisor = 1;
+	vector<double> &scratch;
+};
+
+} // namespace duckdb
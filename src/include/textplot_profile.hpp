@@ -0,0 +1,47 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/mutex.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/main/client_context_state.hpp"
+#include "textplot_stats.hpp"
+
+namespace duckdb {
+
+// The work of every tp_* expression of the last query that ran with the query profiler on (PRAGMA
+// enable_profiling or EXPLAIN ANALYZE), per connection. The profiler's own output only has the time of the
+// whole projection, tp_profile() splits it up by expression.
+class TextplotProfileState : public ClientContextState {
+public:
+	struct Entry {
+		string expression;
+		string alias;
+		TextplotStatsFunction function;
+		TextplotStatsValues values;
+		idx_t cache_hits = 0;
+		idx_t cache_misses = 0;
+	};
+
+	static TextplotProfileState &Get(ClientContext &context);
+
+	// Adds a chunk of 'expr', called concurrently by the threads of the query
+	void Record(const Expression &expr, TextplotStatsFunction function, const TextplotStatsValues &values,
+	            idx_t cache_hits, idx_t cache_misses);
+
+	void QueryBegin(ClientContext &context) override;
+	void QueryEnd(ClientContext &context) override;
+
+	vector<Entry> LastQuery();
+
+private:
+	mutex lock;
+	// The expressions of the running query in the order they were first seen
+	unordered_map<const Expression *, idx_t> current_index;
+	vector<Entry> current;
+	vector<Entry> last;
+};
+
+// tp_profile(): one row per tp_* expression of the last profiled query
+TableFunction TextplotProfileTableFunction();
+
+} // namespace duckdb
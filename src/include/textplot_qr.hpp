@@ -12,6 +12,19 @@ namespace duckdb {
 unique_ptr<FunctionData> TextplotQRBind(ClientContext &context, ScalarFunction &bound_function,
                                         vector<unique_ptr<Expression>> &arguments);
 
+unique_ptr<FunctionLocalState> TextplotQRInitLocalState(ExpressionState &state, const BoundFunctionExpression &expr,
+                                                        FunctionData *bind_data);
+
 void TextplotQR(DataChunk &args, ExpressionState &state, Vector &result);
 
+// tp_qr_matrix(data, ...): the encoded modules as a bit-packed BLOB
+unique_ptr<FunctionData> TextplotQRMatrixBind(ClientContext &context, ScalarFunction &bound_function,
+                                              vector<unique_ptr<Expression>> &arguments);
+void TextplotQRMatrix(DataChunk &args, ExpressionState &state, Vector &result);
+
+// tp_qr_render(matrix, ...): draws a BLOB of tp_qr_matrix like tp_qr
+unique_ptr<FunctionData> TextplotQRRenderBind(ClientContext &context, ScalarFunction &bound_function,
+                                              vector<unique_ptr<Expression>> &arguments);
+void TextplotQRRender(DataChunk &args, ExpressionState &state, Vector &result);
+
 } // namespace duckdb
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/atomic.hpp"
+#include "duckdb/common/mutex.hpp"
+#include "duckdb/storage/object_cache.hpp"
+#include <list>
+
+namespace duckdb {
+
+// Entries kept by default, see the tp_qr_cache_size setting
+static constexpr idx_t TEXTPLOT_QR_DEFAULT_CACHE_SIZE = 4096;
+
+struct TextplotQRCacheStats {
+	idx_t hits;
+	idx_t misses;
+	idx_t entries;
+	idx_t capacity;
+};
+
+// Recently rendered tp_qr results, shared by all connections of a database through its ObjectCache.
+//
+// Entries are found by the hash of the payload and the rendering options and then compared in full, so a hash
+// collision is a miss rather than a wrong QR code. The least recently used entry is evicted once the cache
+// holds 'capacity' entries, a capacity of 0 disables it.
+class TextplotQRCache : public ObjectCacheEntry {
+public:
+	explicit TextplotQRCache(idx_t capacity_p) : capacity(capacity_p) {
+	}
+
+	static string ObjectType() {
+		return "textplot_qr_cache";
+	}
+	string GetObjectType() override {
+		return ObjectType();
+	}
+	// Bounded by tp_qr_cache_size, so it is never evicted from the ObjectCache
+	optional_idx GetEstimatedCacheMemory() const override {
+		return optional_idx();
+	}
+
+	// The cache of the database of 'context', created with the current tp_qr_cache_size
+	static shared_ptr<TextplotQRCache> Get(ClientContext &context);
+
+	// Returns the rendering of 'payload' with 'options' or nullptr, 'hash' covers both
+	shared_ptr<const string> Lookup(hash_t hash, const string_t &payload, const string &options);
+	void Insert(hash_t hash, const string_t &payload, const string &options, shared_ptr<const string> rendered);
+
+	void SetCapacity(idx_t capacity);
+	bool Enabled() const {
+		return capacity > 0;
+	}
+	TextplotQRCacheStats GetStats() const;
+
+private:
+	struct Entry {
+		hash_t hash;
+		string payload;
+		string options;
+		shared_ptr<const string> rendered;
+	};
+
+	void Evict(idx_t target);
+
+	mutable mutex lock;
+	// Most recently used first
+	std::list<Entry> entries;
+	unordered_map<hash_t, std::list<Entry>::iterator> index;
+	atomic<idx_t> capacity;
+	idx_t hits = 0;
+	idx_t misses = 0;
+};
+
+// Called when tp_qr_cache_size is set, resizes the cache right away. The setting is global only, like the cache.
+void TextplotQRCacheSizeSetting(ClientContext &context, SetScope scope, Value &parameter);
+
+// tp_qr_cache_stats(): the counters of the cache as a STRUCT
+LogicalType TextplotQRCacheStatsType();
+void TextplotQRCacheStatsFunction(DataChunk &args, ExpressionState &state, Vector &result);
+
+} // namespace duckdb
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/types/vector.hpp"
+
+namespace duckdb {
+
+// Collects the glyphs of one plot as runs and writes them out in one go. The final length is known before
+// anything is copied, so the result is allocated once with StringVector::EmptyString and filled in place
+// instead of growing a std::string and copying it into the vector afterwards.
+//
+// Only pointers to the glyphs are kept, they have to outlive the render, which holds for glyphs owned by
+// the bind data or the static theme tables. Reused from row to row the run buffer stops allocating.
+class TextplotRender {
+public:
+	void Clear() {
+		runs.clear();
+		size = 0;
+	}
+
+	// Appends 'count' copies of a glyph, consecutive copies of the same glyph become one run
+	void Append(const string &glyph, idx_t count = 1) {
+		Append(glyph.data(), glyph.size(), count);
+	}
+	void Append(const char *data, idx_t length, idx_t count = 1) {
+		if (count == 0 || length == 0) {
+			return;
+		}
+		size += length * count;
+		if (!runs.empty() && runs.back().data == data && runs.back().length == length) {
+			runs.back().count += count;
+			return;
+		}
+		runs.push_back(Run {data, length, count});
+	}
+
+	// Length of the output in bytes
+	idx_t Size() const {
+		return size;
+	}
+
+	// Writes the plot into a new string of the result vector
+	string_t Write(Vector &result) const;
+	string ToString() const;
+
+private:
+	struct Run {
+		const char *data;
+		idx_t length;
+		idx_t count;
+	};
+
+	void WriteTo(char *target) const;
+
+	vector<Run> runs;
+	idx_t size = 0;
+};
+
+} // namespace duckdb
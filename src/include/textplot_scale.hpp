@@ -0,0 +1,70 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/optional_idx.hpp"
+#include "duckdb/common/types/vector.hpp"
+
+namespace duckdb {
+
+// A 'min' or 'max' argument of a tp_* function. It is either a constant known at bind time or a per-row
+// DOUBLE column, the latter allows window expressions such as min(x) OVER (PARTITION BY host) so that
+// every row of a partition is rendered on the same scale in a single pass.
+struct TextplotScaleBound {
+	double value = 0;
+	bool is_set = false;
+	optional_idx column;
+
+	bool operator==(const TextplotScaleBound &other) const {
+		if (column.IsValid() != other.column.IsValid()) {
+			return false;
+		}
+		if (column.IsValid() && column.GetIndex() != other.column.GetIndex()) {
+			return false;
+		}
+		return value == other.value && is_set == other.is_set;
+	}
+	bool IsConstant() const {
+		return is_set && !column.IsValid();
+	}
+};
+
+// Binds the argument at 'index' as a scale bound, non-constant arguments are cast to DOUBLE in place.
+TextplotScaleBound TextplotBindScaleBound(ClientContext &context, const string &function_name, const string &alias,
+                                          vector<unique_ptr<Expression>> &arguments, idx_t index);
+
+// Completes a scale of which only one end was given, 'min' and 'max' hold the given bound and the extent of the
+// data. When the given bound lies beyond all of the data the other end is moved past it, so that every value is
+// clamped to the given bound rather than the scale being inverted.
+void TextplotClampOpenScale(bool has_min, bool has_max, double &min, double &max);
+
+// Reads a scale bound for each row of a chunk
+class TextplotScaleReader {
+public:
+	TextplotScaleReader(const TextplotScaleBound &bound, DataChunk &args);
+
+	// Returns false if the bound is not set or NULL for this row
+	bool Get(idx_t row, double &result) const {
+		if (!data) {
+			result = bound.value;
+			return bound.is_set;
+		}
+		const auto idx = format.sel->get_index(row);
+		if (!format.validity.RowIsValid(idx)) {
+			return false;
+		}
+		result = data[idx];
+		return true;
+	}
+
+	// True if a per-row bound is NULL, such rows produce NULL
+	bool IsNull(idx_t row) const {
+		return data && !format.validity.RowIsValid(format.sel->get_index(row));
+	}
+
+private:
+	const TextplotScaleBound &bound;
+	UnifiedVectorFormat format;
+	const double *data = nullptr;
+};
+
+} // namespace duckdb
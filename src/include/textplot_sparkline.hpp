@@ -3,15 +3,100 @@
 #include "duckdb.hpp"
 #include "duckdb/function/scalar_function.hpp"
 #include "duckdb/common/exception.hpp"
+#include "duckdb/function/aggregate_function.hpp"
+#include "textplot_scale.hpp"
 #include <unordered_map>
 #include <vector>
 
 namespace duckdb {
 
+struct TextplotListLocalState;
+class TextplotRender;
+
+/**
+ * Sparkline generation modes
+ */
+enum class SparklineMode {
+	ABSOLUTE, // Show absolute values (height-based)
+	DELTA,    // Show change direction (up/down/same)
+	TREND     // Show trend direction with magnitude
+};
+
+// Sparkline bind data structure, shared by tp_sparkline and tp_sparkline_agg
+struct TextplotSparklineBindData : public FunctionData {
+	SparklineMode mode = SparklineMode::ABSOLUTE;
+	string theme = "utf8_blocks";
+
+	int64_t width = 10;
+
+	// Optional fixed scale for the absolute mode
+	TextplotScaleBound min;
+	TextplotScaleBound max;
+
+	// Elements sampled from each list, 0 reads all of them
+	idx_t max_samples = 0;
+
+	// The characters of the theme, resolved once at bind time
+	const vector<string> *glyphs;
+
+	// Bound to several series, the bind data is a TextplotSparklineSeriesBindData
+	bool multi_series = false;
+
+	TextplotSparklineBindData(SparklineMode mode_p, string theme_p, int64_t width_p, TextplotScaleBound min_p,
+	                          TextplotScaleBound max_p, idx_t max_samples_p);
+
+	unique_ptr<FunctionData> Copy() const override;
+	bool Equals(const FunctionData &other_p) const override;
+};
+
+// Binds the optional arguments (width, mode, theme, min, max, approx, max_samples) starting at 'first_option'.
+// Per-row min/max columns are only accepted if 'allow_row_bounds' is set. With 'series_options' the 'as_list'
+// and 'labels' arguments of the multi-series form are left to its bind.
+unique_ptr<TextplotSparklineBindData> TextplotSparklineBindOptions(ClientContext &context,
+                                                                   const string &function_name,
+                                                                   vector<unique_ptr<Expression>> &arguments,
+                                                                   idx_t first_option, bool allow_row_bounds,
+                                                                   bool series_options = false);
+
+// Renders the values in order, scale_min/scale_max override the range of the data in the absolute mode
+string TextplotRenderSparkline(const TextplotSparklineBindData &bind_data, const double *data, idx_t size,
+                               const double *scale_min, const double *scale_max);
+
+// Appends the sparkline of one series to 'result' using the buffers of 'scratch'. 'trend_threshold' replaces
+// the threshold the trend mode takes from the data when given.
+void TextplotAppendSparkline(const TextplotSparklineBindData &bind_data, const double *data, idx_t size,
+                             const double *scale_min, const double *scale_max, const double *trend_threshold,
+                             TextplotListLocalState &scratch, TextplotRender &result);
+// The trend mode threshold over several series, series i spans data[bounds[i]] to data[bounds[i + 1]]
+double TextplotSparklineTrendThreshold(const double *data, const idx_t *bounds, idx_t series_count,
+                                       vector<double> &magnitudes);
+
+// Building blocks of the three modes, for callers that already hold the values in order. The glyphs are
+// those of the bound theme and mode, the plot is appended to 'result' using the buffers of 'scratch'.
+const vector<string> &TextplotSparklineGlyphs(const TextplotSparklineBindData &bind_data);
+// Absolute mode from prefix sums, prefix_sums[i] - prefix_sums[0] is the sum of the first i values
+void TextplotAppendAbsoluteSparkline(const vector<string> &glyphs, const double *prefix_sums, idx_t size,
+                                     idx_t width, double min, double max, TextplotListLocalState &scratch,
+                                     TextplotRender &result);
+void TextplotAppendDeltaSparkline(const vector<string> &glyphs, const double *data, idx_t size, idx_t width,
+                                  TextplotListLocalState &scratch, TextplotRender &result);
+// Trend mode, changes larger than 'threshold' are drawn as large
+void TextplotAppendTrendSparkline(const vector<string> &glyphs, const double *data, idx_t size, idx_t width,
+                                  double threshold, TextplotListLocalState &scratch, TextplotRender &result);
+
 // Function declarations
 unique_ptr<FunctionData> TextplotSparklineBind(ClientContext &context, ScalarFunction &bound_function,
                                                vector<unique_ptr<Expression>> &arguments);
 
 void TextplotSparkline(DataChunk &args, ExpressionState &state, Vector &result);
 
+// tp_sparkline over several series (a LIST of lists, or a MAP or STRUCT of lists), rendered on one shared
+// scale. Bound through TextplotSparklineBind and called by TextplotSparkline.
+unique_ptr<FunctionData> TextplotSparklineSeriesBind(ClientContext &context, ScalarFunction &bound_function,
+                                                     vector<unique_ptr<Expression>> &arguments);
+void TextplotSparklineSeries(DataChunk &args, ExpressionState &state, Vector &result);
+
+// tp_sparkline_agg(value, ts, ...): streaming aggregate form of tp_sparkline
+AggregateFunctionSet TextplotSparklineAggFunctions();
+
 } // namespace duckdb
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/function/table_function.hpp"
+#include <chrono>
+
+namespace duckdb {
+
+// The functions tp_stats() reports on, in the order of its rows
+enum class TextplotStatsFunction : uint8_t { BAR, DENSITY, SPARKLINE, QR, QR_MATRIX, QR_RENDER, COUNT };
+
+struct TextplotStatsValues {
+	idx_t rows = 0;
+	idx_t elements = 0;
+	idx_t bytes = 0;
+	idx_t nanos = 0;
+};
+
+// The SQL name of 'function'
+const char *TextplotStatsFunctionName(TextplotStatsFunction function);
+
+// Measures one chunk of a tp_* scalar function into the counters of the current thread. Threads only write their
+// own counters, tp_stats() merges them when it is queried. With tp_stats_enabled = false the scope costs one
+// setting lookup per chunk. While the query profiler is on the chunk is also recorded for tp_profile().
+class TextplotStatsScope {
+public:
+	TextplotStatsScope(ExpressionState &state, TextplotStatsFunction function);
+
+	// Lookups in the tp_qr cache, only reported by tp_profile()
+	void CacheHit() {
+		cache_hits++;
+	}
+	void CacheMiss() {
+		cache_misses++;
+	}
+
+	// Counts the non-NULL rows of 'result' and their bytes, 'elements' is the input read to render them
+	void Record(Vector &result, idx_t count, idx_t elements);
+
+private:
+	ExpressionState &state;
+	TextplotStatsFunction function;
+	// tp_stats_enabled
+	bool enabled;
+	// PRAGMA enable_profiling or EXPLAIN ANALYZE
+	bool profiling;
+	idx_t cache_hits = 0;
+	idx_t cache_misses = 0;
+	std::chrono::steady_clock::time_point start;
+};
+
+// tp_stats(): rows, input elements, output bytes and time per function since the extension was loaded or
+// tp_stats_reset() was called. The counters are shared by all databases of the process.
+TableFunction TextplotStatsTableFunction();
+
+// tp_stats_reset(): sets the counters of tp_stats() back to zero
+TableFunction TextplotStatsResetTableFunction();
+
+} // namespace duckdb
@@ -3,10 +3,12 @@
 #include "duckdb.hpp"
 #include "duckdb/common/http_util.hpp"
 #include "yyjson.hpp"
-#include "duckdb/main/extension_helper.hpp"
 #include "duckdb/main/config.hpp"
+#include "duckdb/logging/logger.hpp"
+#include "duckdb/common/mutex.hpp"
+#include "duckdb/common/unordered_set.hpp"
 #include <cstdlib>
-#include <future>
+#include <system_error>
 using namespace duckdb_yyjson; // NOLINT
 
 namespace duckdb
@@ -15,24 +17,78 @@ namespace duckdb
 	namespace
 	{
 
-		// Function to send the actual HTTP request
-		void sendHTTPRequest(shared_ptr<DatabaseInstance> db, char *json_body, size_t json_body_size)
+		const char *const DEFAULT_TELEMETRY_URL = "https://duckdb-in.query-farm.services/";
+
+		// The request is abandoned after this long, unreachable hosts never keep a thread around for longer
+		constexpr uint64_t TELEMETRY_TIMEOUT_SECONDS = 3;
+
+		// QUERY_FARM_TELEMETRY_URL points the telemetry at another endpoint, e.g. a local stand-in
+		string telemetryURL()
 		{
-			const string TARGET_URL("https://duckdb-in.query-farm.services/");
+			const char *url = std::getenv("QUERY_FARM_TELEMETRY_URL");
+			if (url != nullptr && *url != '\0')
+			{
+				return url;
+			}
+			return DEFAULT_TELEMETRY_URL;
+		}
+
+		// Extensions and versions that already sent telemetry in this process. A process that opens many databases
+		// and loads the extension into each of them sends it once, not once per database.
+		mutex sent_lock;
+		unordered_set<string> sent;
 
-			HTTPHeaders headers;
-			headers.Insert("Content-Type", "application/json");
+		// Returns true the first time it is called for an extension version
+		bool claimTelemetry(const string &extension_name, const string &extension_version)
+		{
+			lock_guard<mutex> guard(sent_lock);
+			return sent.insert(extension_name + "/" + extension_version).second;
+		}
+
+		// The query_farm_telemetry_opt_out option, which the extension registers before sending. It is read while the
+		// extension is loaded, so it has to be in the configuration the database is opened with.
+		bool telemetryOptedOut(DatabaseInstance &db)
+		{
+			auto &config = DBConfig::GetConfig(db);
+			Value opt_out;
+			if (config.TryGetCurrentSetting("query_farm_telemetry_opt_out", opt_out) && !opt_out.IsNull())
+			{
+				return BooleanValue::Get(opt_out);
+			}
+			return false;
+		}
 
-			auto &http_util = HTTPUtil::Get(*db);
-			unique_ptr<HTTPParams> params = http_util.InitializeParameters(*db, TARGET_URL);
+		// Every database logs what became of its telemetry, also when the process already sent it
+		void logTelemetry(DatabaseInstance &db, const string &extension_name, const string &outcome)
+		{
+			const auto message = "query_farm_telemetry: " + extension_name + " " + outcome;
+			DUCKDB_LOG_INFO(db, message.c_str());
+		}
 
-			PostRequestInfo post_request(TARGET_URL, headers, *params, reinterpret_cast<const_data_ptr_t>(json_body),
-																	 json_body_size);
+		// Function to send the actual HTTP request
+		void sendHTTPRequest(weak_ptr<DatabaseInstance> weak_db, const string &target_url, char *json_body,
+												 size_t json_body_size)
+		{
 			try
 			{
-				auto response = http_util.Request(post_request);
+				// Gone if the database was closed before the thread got here. It is only kept open for the request
+				// itself, which gives up after TELEMETRY_TIMEOUT_SECONDS.
+				if (auto db = weak_db.lock())
+				{
+					HTTPHeaders headers;
+					headers.Insert("Content-Type", "application/json");
+
+					auto &http_util = HTTPUtil::Get(*db);
+					unique_ptr<HTTPParams> params = http_util.InitializeParameters(*db, target_url);
+					params->timeout = TELEMETRY_TIMEOUT_SECONDS;
+					params->retries = 0;
+
+					PostRequestInfo post_request(target_url, headers, *params,
+																			 reinterpret_cast<const_data_ptr_t>(json_body), json_body_size);
+					auto response = http_util.Request(post_request);
+				}
 			}
-			catch (const std::exception &e)
+			catch (...)
 			{
 				// ignore all errors.
 			}
@@ -46,25 +102,28 @@ namespace duckdb
 	INTERNAL_FUNC void QueryFarmSendTelemetry(ExtensionLoader &loader, const string &extension_name,
 																						const string &extension_version)
 	{
+		auto &db = loader.GetDatabaseInstance();
 		const char *opt_out = std::getenv("QUERY_FARM_TELEMETRY_OPT_OUT");
-		if (opt_out != nullptr)
+		if (opt_out != nullptr || telemetryOptedOut(db))
 		{
+			logTelemetry(db, extension_name, "not sent, opted out");
 			return;
 		}
 
-		try
-		{
-			ExtensionHelper::TryAutoLoadExtension(loader.GetDatabaseInstance(), "httpfs");
-		}
-		catch (...)
+		// httpfs is never installed or loaded for the telemetry, without it already loaded nothing is sent. The
+		// send is not claimed either, so loading the extension into a database that has httpfs still sends it.
+		if (!db.ExtensionIsLoaded("httpfs"))
 		{
+			logTelemetry(db, extension_name, "not sent, httpfs is not loaded");
 			return;
 		}
 
-		if (!loader.GetDatabaseInstance().ExtensionIsLoaded("httpfs"))
+		if (!claimTelemetry(extension_name, extension_version))
 		{
+			logTelemetry(db, extension_name, "not sent, already sent by this process");
 			return;
 		}
+		logTelemetry(db, extension_name, "sending");
 
 		// Initialize the telemetry sender
 		auto doc = yyjson_mut_doc_new(nullptr);
@@ -93,14 +152,24 @@ namespace duckdb
 
 		yyjson_mut_doc_free(doc);
 
+		weak_ptr<DatabaseInstance> weak_db = db.shared_from_this();
 #ifndef __EMSCRIPTEN__
-		[[maybe_unused]] auto _ = std::async(
-				std::launch::async, [db_ptr = loader.GetDatabaseInstance().shared_from_this(), json = telemetry_data,
-														 len = telemetry_len]() mutable
-				{ sendHTTPRequest(std::move(db_ptr), json, len); });
+		// Detached, nothing waits for the request: LOAD returns right away and the thread ends on its own after
+		// at most TELEMETRY_TIMEOUT_SECONDS
+		try
+		{
+			std::thread([weak_db, url = telemetryURL(), json = telemetry_data, len = telemetry_len]()
+									{ sendHTTPRequest(weak_db, url, json, len); })
+					.detach();
+		}
+		catch (const std::system_error &)
+		{
+			// No thread available, skip the telemetry
+			free(telemetry_data);
+		}
 #else
-		sendHTTPRequest(loader.GetDatabaseInstance().shared_from_this(), telemetry_data, telemetry_len);
+		sendHTTPRequest(weak_db, telemetryURL(), telemetry_data, telemetry_len);
 #endif
 	}
 
-} // namespace duckdb
\ No newline at end of file
+} // namespace duckdb
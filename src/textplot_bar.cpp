@@ -1,10 +1,14 @@
 #include "textplot_bar.hpp"
+#include "textplot_scale.hpp"
+#include "textplot_stats.hpp"
 #include "duckdb/common/string_util.hpp"
 #include "duckdb/function/scalar_function.hpp"
-#include "duckdb/common/vector_operations/unary_executor.hpp"
+#include "duckdb/common/types/vector.hpp"
+#include "duckdb/common/types/selection_vector.hpp"
 #include "duckdb/planner/expression/bound_function_expression.hpp"
 #include "duckdb/execution/expression_executor.hpp"
 #include <algorithm>
+#include <cmath>
 
 namespace duckdb {
 
@@ -23,8 +27,8 @@ const std::unordered_map<std::string, std::string> emoji_hearts = {{"red", "❤
 
 // Bar chart bind data structure
 struct TextplotBarBindData : public FunctionData {
-	double min = 0;
-	double max = 1.0;
+	TextplotScaleBound min;
+	TextplotScaleBound max;
 	int64_t width = 10;
 	string on = "_";
 	string off = "*";
@@ -34,31 +38,115 @@ struct TextplotBarBindData : public FunctionData {
 	string on_color = "red";
 	string off_color = "white";
 
-	TextplotBarBindData(double min_p, double max_p, int64_t width_p, string on_p, string off_p, bool filled_p,
-	                    vector<std::pair<double, string>> thresholds_p, string shape_p, string on_color_p,
-	                    string off_color_p)
+	// Every bar this function can produce, rendered once at bind time. Entry 0 is NULL, followed by one
+	// row of width + 1 bars (0..width filled blocks) per color band, a band being a threshold entry.
+	// Results are dictionary vectors that select into these entries. The atlas grows with the width squared
+	// and with the number of bands, so wide bars and large atlases have none and are rendered row by row.
+	// Copies of the bind data share it.
+	shared_ptr<Vector> dictionary;
+	idx_t band_count = 1;
+	// The glyph of filled blocks per band and of empty blocks
+	vector<string> on_chars;
+	string off_char;
+
+	static constexpr idx_t NULL_ENTRY = 0;
+	// Widest bar that is pre-rendered into the atlas
+	static constexpr int64_t MAX_ATLAS_WIDTH = 256;
+	// Most bars in the atlas, over all bands
+	static constexpr idx_t MAX_ATLAS_ENTRIES = 4096;
+
+	TextplotBarBindData(TextplotScaleBound min_p, TextplotScaleBound max_p, int64_t width_p, string on_p,
+	                    string off_p, bool filled_p, vector<std::pair<double, string>> thresholds_p, string shape_p,
+	                    string on_color_p, string off_color_p, shared_ptr<Vector> dictionary_p = nullptr)
 	    : min(min_p), max(max_p), width(width_p), on(std::move(on_p)), off(std::move(off_p)), filled(filled_p),
 	      thresholds(std::move(thresholds_p)), char_shape(std::move(shape_p)), on_color(std::move(on_color_p)),
-	      off_color(std::move(off_color_p)) {
+	      off_color(std::move(off_color_p)), dictionary(std::move(dictionary_p)) {
+		BuildGlyphs();
+		if (!dictionary && width <= MAX_ATLAS_WIDTH && 1 + band_count * (width + 1) <= MAX_ATLAS_ENTRIES) {
+			BuildDictionary();
+		}
 	}
 
-	string get_character(double value, bool is_on) const {
-		if (!is_on) {
-			if (!off.empty()) {
-				return off;
+	// Index of the color band used for a value, bands follow the (descending) threshold order.
+	idx_t get_band(double value) const {
+		if (band_count == 1) {
+			return 0;
+		}
+		for (idx_t i = 0; i < thresholds.size(); i++) {
+			if (value >= thresholds[i].first) {
+				return i;
 			}
-			return get_char(off_color, "white", char_shape);
+		}
+		return thresholds.size() - 1;
+	}
+
+	// Dictionary entry holding the bar for a value scaled between min_value and max_value
+	idx_t get_entry(double value, double min_value, double max_value) const {
+		double proportion;
+		if (max_value == min_value) {
+			// Avoid division by zero: if value equals min/max, show full bar; otherwise empty
+			proportion = (value >= min_value) ? 1.0 : 0.0;
+		} else if (min_value > max_value) {
+			throw InvalidInputException("tp_bar: 'min' must be less than 'max'");
 		} else {
-			if (!on.empty()) {
-				return on;
-			}
-			return get_char(get_threshold_color(value, on_color), "red", char_shape);
+			proportion = std::clamp((value - min_value) / (max_value - min_value), 0.0, 1.0);
+		}
+		if (std::isnan(proportion)) {
+			// NaN values render as an empty bar, the entry must stay in range
+			proportion = 0.0;
+		}
+		const auto filled_blocks = static_cast<idx_t>(std::round(width * proportion));
+		return 1 + get_band(value) * (width + 1) + filled_blocks;
+	}
+
+	bool has_atlas() const {
+		return dictionary != nullptr;
+	}
+
+	// Renders the bar of a (non-NULL) entry into 'bar'
+	void render_entry(idx_t entry, string &bar) const {
+		const auto band = (entry - 1) / (width + 1);
+		const auto filled_blocks = static_cast<int64_t>((entry - 1) % (width + 1));
+		const auto &on_char = on_chars[band];
+		bar.clear();
+		for (int64_t i = 0; i < width; i++) {
+			const bool is_on = filled ? i < filled_blocks : (i == filled_blocks - 1 && filled_blocks > 0);
+			bar += is_on ? on_char : off_char;
 		}
 	}
+
 	unique_ptr<FunctionData> Copy() const override;
 	bool Equals(const FunctionData &other_p) const override;
 
 private:
+	void BuildGlyphs() {
+		// A custom "on" character ignores colors, so only one band is needed.
+		band_count = (on.empty() && !thresholds.empty()) ? thresholds.size() : 1;
+
+		off_char = !off.empty() ? off : get_char(off_color, "white", char_shape);
+		for (idx_t band = 0; band < band_count; band++) {
+			if (!on.empty()) {
+				on_chars.push_back(on);
+			} else {
+				on_chars.push_back(
+				    get_char(thresholds.empty() ? on_color : thresholds[band].second, "red", char_shape));
+			}
+		}
+	}
+
+	void BuildDictionary() {
+		const auto entry_count = 1 + band_count * (width + 1);
+		dictionary = make_shared_ptr<Vector>(LogicalType::VARCHAR, entry_count);
+		auto entries = FlatVector::GetData<string_t>(*dictionary);
+		FlatVector::SetNull(*dictionary, NULL_ENTRY, true);
+
+		string bar;
+		for (idx_t entry = NULL_ENTRY + 1; entry < entry_count; entry++) {
+			render_entry(entry, bar);
+			entries[entry] = StringVector::AddString(*dictionary, bar);
+		}
+	}
+
 	string get_char(const string &color, const string &default_color, const string &shape) const {
 		const std::unordered_map<std::string, std::string> *lookup_map = nullptr;
 		if (shape == "square") {
@@ -81,22 +169,11 @@ private:
 			return lookup_map->at(default_color);
 		}
 	}
-	std::string get_threshold_color(double n, const string &default_color) const {
-		if (thresholds.empty()) {
-			return default_color;
-		}
-		for (const auto &t : thresholds) {
-			if (n >= t.first) {
-				return t.second;
-			}
-		}
-		return thresholds.back().second;
-	}
 };
 
 unique_ptr<FunctionData> TextplotBarBindData::Copy() const {
 	return make_uniq<TextplotBarBindData>(min, max, width, on, off, filled, thresholds, char_shape, on_color,
-	                                      off_color);
+	                                      off_color, dictionary);
 }
 
 bool TextplotBarBindData::Equals(const FunctionData &other_p) const {
@@ -117,8 +194,12 @@ unique_ptr<FunctionData> TextplotBarBind(ClientContext &context, ScalarFunction
 	}
 
 	// Optional arguments
-	double min = 0;
-	double max = 1.0;
+	TextplotScaleBound min;
+	min.is_set = true;
+	min.value = 0;
+	TextplotScaleBound max;
+	max.is_set = true;
+	max.value = 1.0;
 	int64_t width = 10;
 	string on = "";
 	string off = "";
@@ -133,23 +214,19 @@ unique_ptr<FunctionData> TextplotBarBind(ClientContext &context, ScalarFunction
 		if (arg->HasParameter()) {
 			throw ParameterNotResolvedException();
 		}
+		const auto alias = arg->GetAlias();
+		if (alias == "min") {
+			// 'min' and 'max' may vary per row, e.g. min(x) OVER (PARTITION BY host)
+			min = TextplotBindScaleBound(context, "tp_bar", alias, arguments, i);
+			continue;
+		} else if (alias == "max") {
+			max = TextplotBindScaleBound(context, "tp_bar", alias, arguments, i);
+			continue;
+		}
 		if (!arg->IsFoldable()) {
 			throw BinderException("tp_bar: arguments must be constant");
 		}
-		const auto &alias = arg->GetAlias();
-		if (alias == "min") {
-			if (!arg->return_type.IsNumeric()) {
-				throw BinderException("tp_bar: 'min' argument must be numeric");
-			}
-			const auto eval_result = ExpressionExecutor::EvaluateScalar(context, *arg);
-			min = eval_result.CastAs(context, LogicalType::DOUBLE).GetValue<double>();
-		} else if (alias == "max") {
-			if (!arg->return_type.IsNumeric()) {
-				throw BinderException("tp_bar: 'max' argument must be numeric");
-			}
-			const auto eval_result = ExpressionExecutor::EvaluateScalar(context, *arg);
-			max = eval_result.CastAs(context, LogicalType::DOUBLE).GetValue<double>();
-		} else if (alias == "thresholds") {
+		if (alias == "thresholds") {
 			if (arg->return_type.InternalType() != PhysicalType::LIST) {
 				throw BinderException(StringUtil::Format(
 				    "tp_bar: 'thresholds' argument must be a list of structs it is %s", arg->return_type.ToString()));
@@ -232,7 +309,7 @@ unique_ptr<FunctionData> TextplotBarBind(ClientContext &context, ScalarFunction
 		throw BinderException("tp_bar: 'width' argument must be at least 1");
 	}
 
-	if (min >= max) {
+	if (min.IsConstant() && max.IsConstant() && min.value >= max.value) {
 		throw BinderException("tp_bar: 'min' must be less than 'max'");
 	}
 
@@ -243,30 +320,64 @@ void TextplotBar(DataChunk &args, ExpressionState &state, Vector &result) {
 	auto &value_vector = args.data[0];
 	const auto &func_expr = state.expr.Cast<BoundFunctionExpression>();
 	const auto &bind_data = func_expr.bind_info->Cast<TextplotBarBindData>();
+	const auto count = args.size();
+	TextplotStatsScope stats(state, TextplotStatsFunction::BAR);
 
-	UnaryExecutor::Execute<double, string_t>(value_vector, result, args.size(), [&](double value) {
-		double proportion;
-		if (bind_data.max == bind_data.min) {
-			// Avoid division by zero: if value equals min/max, show full bar; otherwise empty
-			proportion = (value >= bind_data.min) ? 1.0 : 0.0;
-		} else {
-			proportion = std::clamp((value - bind_data.min) / (bind_data.max - bind_data.min), 0.0, 1.0);
+	const TextplotScaleReader min_reader(bind_data.min, args);
+	const TextplotScaleReader max_reader(bind_data.max, args);
+
+	if (args.AllConstant()) {
+		result.SetVectorType(VectorType::CONSTANT_VECTOR);
+		double min_value;
+		double max_value;
+		if (ConstantVector::IsNull(value_vector) || !min_reader.Get(0, min_value) || !max_reader.Get(0, max_value)) {
+			ConstantVector::SetNull(result, true);
+			stats.Record(result, count, 0);
+			return;
 		}
-		const auto filled_blocks = static_cast<int64_t>(std::round(bind_data.width * proportion));
+		const auto value = ConstantVector::GetData<double>(value_vector)[0];
+		string bar;
+		bind_data.render_entry(bind_data.get_entry(value, min_value, max_value), bar);
+		ConstantVector::GetData<string_t>(result)[0] = StringVector::AddString(result, bar);
+		stats.Record(result, count, count);
+		return;
+	}
 
+	UnifiedVectorFormat value_format;
+	value_vector.ToUnifiedFormat(count, value_format);
+	const auto values = UnifiedVectorFormat::GetData<double>(value_format);
+
+	// Rows only select a pre-rendered bar, the bar strings themselves are shared by every chunk.
+	SelectionVector sel(count);
+	idx_t elements = 0;
+	for (idx_t i = 0; i < count; i++) {
+		const auto idx = value_format.sel->get_index(i);
+		double min_value;
+		double max_value;
+		if (value_format.validity.RowIsValid(idx) && min_reader.Get(i, min_value) && max_reader.Get(i, max_value)) {
+			sel.set_index(i, bind_data.get_entry(values[idx], min_value, max_value));
+			elements++;
+		} else {
+			sel.set_index(i, TextplotBarBindData::NULL_ENTRY);
+		}
+	}
+	if (bind_data.has_atlas()) {
+		result.Slice(*bind_data.dictionary, sel, count);
+	} else {
+		result.SetVectorType(VectorType::FLAT_VECTOR);
+		auto result_data = FlatVector::GetData<string_t>(result);
 		string bar;
-		bar.reserve(bind_data.width * 4); // Reserve space for potential multi-byte characters
-		for (int64_t i = 0; i < bind_data.width; i++) {
-			if (bind_data.filled) {
-				// Fill all blocks up to the proportion
-				bar += bind_data.get_character(value, i < filled_blocks);
-			} else {
-				// Only fill the transition point
-				bar += bind_data.get_character(value, i == filled_blocks - 1 && filled_blocks > 0);
+		for (idx_t i = 0; i < count; i++) {
+			const auto entry = sel.get_index(i);
+			if (entry == TextplotBarBindData::NULL_ENTRY) {
+				FlatVector::SetNull(result, i, true);
+				continue;
 			}
+			bind_data.render_entry(entry, bar);
+			result_data[i] = StringVector::AddString(result, bar);
 		}
-		return StringVector::AddString(result, bar);
-	});
+	}
+	stats.Record(result, count, elements);
 }
 
 } // namespace duckdb
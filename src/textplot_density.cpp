@@ -1,12 +1,15 @@
 #include "textplot_density.hpp"
+#include "textplot_kernels.hpp"
+#include "textplot_list.hpp"
+#include "textplot_stats.hpp"
 #include "duckdb/common/string_util.hpp"
 #include "duckdb/function/scalar_function.hpp"
-#include "duckdb/common/vector_operations/unary_executor.hpp"
 #include "duckdb/planner/expression/bound_function_expression.hpp"
 #include "duckdb/execution/expression_executor.hpp"
 #include "duckdb/common/types/vector.hpp"
 #include <algorithm>
 #include <cmath>
+#include <limits>
 
 namespace duckdb {
 
@@ -25,72 +28,67 @@ const std::unordered_map<std::string, std::vector<std::string>> density_sets = {
     {"white", {" ", "⚪", "🔘", "⚫"}},
 };
 
-// Density plot bind data structure
-struct TextplotDensityBindData : public FunctionData {
-	int64_t width = 20;
-	std::vector<std::string> density_chars;
-	string marker_char;
-
-	TextplotDensityBindData(int64_t width_p, std::vector<std::string> density_chars_p, string marker_char_p)
-	    : width(width_p), density_chars(std::move(density_chars_p)), marker_char(std::move(marker_char_p)) {
-	}
-
-	unique_ptr<FunctionData> Copy() const override {
-		return make_uniq<TextplotDensityBindData>(width, density_chars, marker_char);
-	}
-	bool Equals(const FunctionData &other_p) const override {
-		const auto &other = other_p.Cast<TextplotDensityBindData>();
-		return width == other.width && density_chars == other.density_chars && marker_char == other.marker_char;
-	}
-};
-
-unique_ptr<FunctionData> TextplotDensityBind(ClientContext &context, ScalarFunction &bound_function,
-                                             vector<unique_ptr<Expression>> &arguments) {
-	if (arguments.empty()) {
-		throw BinderException("tp_density takes at least one argument");
-	}
-
-	const auto &first_arg = arguments[0]->return_type;
-	if (!first_arg.IsNested() || first_arg.InternalType() != PhysicalType::LIST ||
-	    !ListType::GetChildType(first_arg).IsNumeric()) {
-		throw InvalidTypeException("tp_density first argument must be a list of numeric values");
+const std::vector<std::string> &TextplotDensityStyle(const string &function_name, const string &style) {
+	const auto it = density_sets.find(style);
+	if (it == density_sets.end()) {
+		throw BinderException(StringUtil::Format("%s: Unknown style '%s'", function_name, style));
 	}
+	return it->second;
+}
 
+unique_ptr<TextplotDensityBindData> TextplotDensityBindOptions(ClientContext &context, const string &function_name,
+                                                               vector<unique_ptr<Expression>> &arguments,
+                                                               idx_t first_option, bool allow_row_bounds) {
 	// Optional arguments
 	int64_t width = 20;
 	std::vector<std::string> graph_characters;
 	string marker_char;
 	string style;
+	TextplotScaleBound min;
+	TextplotScaleBound max;
+	bool smooth = false;
+	double bandwidth = 0;
+	idx_t max_samples = 0;
 
-	for (idx_t i = 1; i < arguments.size(); i++) {
+	for (idx_t i = first_option; i < arguments.size(); i++) {
 		const auto &arg = arguments[i];
 		if (arg->HasParameter()) {
 			throw ParameterNotResolvedException();
 		}
+		const auto alias = arg->GetAlias();
+		if ((alias == "min" || alias == "max") && (allow_row_bounds || arg->IsFoldable())) {
+			// 'min' and 'max' may vary per row, e.g. to share one range across a window partition
+			auto &bound = alias == "min" ? min : max;
+			bound = TextplotBindScaleBound(context, function_name, alias, arguments, i);
+			continue;
+		}
 		if (!arg->IsFoldable()) {
-			throw BinderException("tp_density: arguments must be constant");
+			throw BinderException(StringUtil::Format("%s: arguments must be constant", function_name));
+		}
+		if (TextplotBindSampling(context, function_name, alias, *arg, max_samples)) {
+			continue;
 		}
-		const auto &alias = arg->GetAlias();
 		if (alias == "width") {
 			if (!arg->return_type.IsIntegral()) {
-				throw BinderException("tp_density: 'width' argument must be an integer");
+				throw BinderException(StringUtil::Format("%s: 'width' argument must be an integer", function_name));
 			}
 			const auto eval_result = ExpressionExecutor::EvaluateScalar(context, *arg);
 			width = eval_result.CastAs(context, LogicalType::UBIGINT).GetValue<uint64_t>();
 		} else if (alias == "marker") {
 			if (arg->return_type.id() != LogicalTypeId::VARCHAR) {
-				throw BinderException("tp_density: 'marker' argument must be a VARCHAR");
+				throw BinderException(StringUtil::Format("%s: 'marker' argument must be a VARCHAR", function_name));
 			}
 			marker_char = StringValue::Get(ExpressionExecutor::EvaluateScalar(context, *arg));
 		} else if (alias == "graph_chars") {
 			if (arg->return_type.id() != LogicalTypeId::VARCHAR) {
-				throw BinderException("tp_density: 'graph_chars' argument must be a VARCHAR");
+				throw BinderException(
+				    StringUtil::Format("%s: 'graph_chars' argument must be a VARCHAR", function_name));
 			}
 
 			if (arg->return_type.InternalType() != PhysicalType::LIST) {
 				throw BinderException(
-				    StringUtil::Format("tp_density: 'graph_chars' argument must be a list of strings it is %s",
-				                       arg->return_type.ToString()));
+				    StringUtil::Format("%s: 'graph_chars' argument must be a list of strings it is %s",
+				                       function_name, arg->return_type.ToString()));
 			}
 
 			const auto list_children = ListValue::GetChildren(ExpressionExecutor::EvaluateScalar(context, *arg));
@@ -98,19 +96,38 @@ unique_ptr<FunctionData> TextplotDensityBind(ClientContext &context, ScalarFunct
 				// These should also be lists.
 				if (list_item.type() != LogicalType::VARCHAR) {
 					throw BinderException(
-					    StringUtil::Format("tp_density: 'graph_chars' child must be a string it is %s value is %s",
-					                       list_item.type().ToString(), list_item.ToString()));
+					    StringUtil::Format("%s: 'graph_chars' child must be a string it is %s value is %s",
+					                       function_name, list_item.type().ToString(), list_item.ToString()));
 				}
 				graph_characters.push_back(StringValue::Get(list_item));
 			}
 
 		} else if (alias == "style") {
 			if (arg->return_type.id() != LogicalTypeId::VARCHAR) {
-				throw BinderException("tp_density: 'style' argument must be a VARCHAR");
+				throw BinderException(StringUtil::Format("%s: 'style' argument must be a VARCHAR", function_name));
 			}
 			style = StringValue::Get(ExpressionExecutor::EvaluateScalar(context, *arg));
+		} else if (alias == "smooth") {
+			// Either true to pick the bandwidth from the data, or the bandwidth itself
+			const auto value = ExpressionExecutor::EvaluateScalar(context, *arg);
+			if (value.IsNull()) {
+				throw BinderException(StringUtil::Format("%s: 'smooth' argument must not be NULL", function_name));
+			}
+			if (arg->return_type.id() == LogicalTypeId::BOOLEAN) {
+				smooth = BooleanValue::Get(value);
+			} else if (arg->return_type.IsNumeric()) {
+				smooth = true;
+				bandwidth = value.CastAs(context, LogicalType::DOUBLE).GetValue<double>();
+				if (!(bandwidth > 0)) {
+					throw BinderException(
+					    StringUtil::Format("%s: 'smooth' bandwidth must be greater than 0", function_name));
+				}
+			} else {
+				throw BinderException(
+				    StringUtil::Format("%s: 'smooth' argument must be a BOOLEAN or a bandwidth", function_name));
+			}
 		} else {
-			throw BinderException(StringUtil::Format("tp_density: Unknown argument '%s'", alias));
+			throw BinderException(StringUtil::Format("%s: Unknown argument '%s'", function_name, alias));
 		}
 	}
 
@@ -119,127 +136,263 @@ unique_ptr<FunctionData> TextplotDensityBind(ClientContext &context, ScalarFunct
 	}
 
 	if (!style.empty()) {
-		// lookup the style in density_sets
-		if (const auto it = density_sets.find(style); it != density_sets.end()) {
-			graph_characters = it->second;
-		} else {
-			throw BinderException(StringUtil::Format("tp_density: Unknown style '%s'", style));
-		}
+		graph_characters = TextplotDensityStyle(function_name, style);
 	}
 
 	if (width < 1) {
-		throw BinderException("tp_density: 'width' argument must be at least 1");
+		throw BinderException(StringUtil::Format("%s: 'width' argument must be at least 1", function_name));
+	}
+
+	if (min.IsConstant() && max.IsConstant() && min.value >= max.value) {
+		throw BinderException(StringUtil::Format("%s: 'min' must be less than 'max'", function_name));
 	}
 
-	return make_uniq<TextplotDensityBindData>(width, graph_characters, marker_char);
+	return make_uniq<TextplotDensityBindData>(width, graph_characters, marker_char, min, max, smooth, bandwidth,
+	                                          max_samples);
 }
 
-void TextplotDensity(DataChunk &args, ExpressionState &state, Vector &result) {
-	const auto &func_expr = state.expr.Cast<BoundFunctionExpression>();
-	const auto &bind_data = func_expr.bind_info->Cast<TextplotDensityBindData>();
+unique_ptr<FunctionData> TextplotDensityBind(ClientContext &context, ScalarFunction &bound_function,
+                                             vector<unique_ptr<Expression>> &arguments) {
+	if (arguments.empty()) {
+		throw BinderException("tp_density takes at least one argument");
+	}
 
-	auto &value_vector = args.data[0];
-	Vector input_data(LogicalType::LIST(LogicalType::DOUBLE));
-	VectorOperations::Cast(state.GetContext(), value_vector, input_data, args.size());
+	const auto &first_arg = arguments[0]->return_type;
+	if (!first_arg.IsNested() || first_arg.InternalType() != PhysicalType::LIST ||
+	    !ListType::GetChildType(first_arg).IsNumeric()) {
+		throw InvalidTypeException("tp_density first argument must be a list of numeric values");
+	}
 
-	auto &child_data = ListVector::GetEntry(input_data);
-	auto source_data = FlatVector::GetData<double>(child_data);
+	TextplotBindNumericList(bound_function, arguments, 0);
+	return TextplotDensityBindOptions(context, "tp_density", arguments, 1, true);
+}
 
-	double markerValue = std::nan("");
+// All values are the same - use max density character
+static void AppendDensityConstant(const TextplotDensityBindData &bind_data, TextplotRender &output_result) {
+	output_result.Append(bind_data.density_chars.back(), bind_data.width);
+}
 
-	UnaryExecutor::Execute<list_entry_t, string_t>(input_data, result, args.size(), [&](list_entry_t values) {
-		std::vector<double> data_items;
-		data_items.reserve(values.length);
+template <class T>
+static void AppendDensityBins(const TextplotDensityBindData &bind_data, const T *bins, int64_t marker_pos,
+                              TextplotRender &output_result) {
+	// Find max count for scaling
+	const double maxCount = static_cast<double>(*std::max_element(bins, bins + bind_data.width));
+	if (maxCount == 0) {
+		output_result.Append(bind_data.density_chars.front(), bind_data.width);
+		return;
+	}
 
-		for (auto i = values.offset; i < values.offset + values.length; i++) {
-			data_items.push_back(source_data[i]);
-		}
+	// Generate ASCII representation using provided character set
+	const int numLevels = bind_data.density_chars.size() - 1;
 
-		if (data_items.empty() || bind_data.width <= 0 || bind_data.density_chars.empty()) {
-			return StringVector::AddString(result, "");
+	for (int64_t i = 0; i < bind_data.width; i++) {
+		// Check if this position should have a marker
+		if (i == marker_pos && !bind_data.marker_char.empty()) {
+			output_result.Append(bind_data.marker_char);
+		} else {
+			// Scale bin count to character range
+			const auto normalized = static_cast<double>(bins[i]) / maxCount;
+			auto charIndex = static_cast<int>(normalized * numLevels + 0.5);
+			charIndex = std::min(charIndex, numLevels);
+			output_result.Append(bind_data.density_chars[charIndex]);
 		}
+	}
+}
 
-		// Find min and max values
-		const auto minmax = std::minmax_element(data_items.cbegin(), data_items.cend());
-		const double minVal = *minmax.first;
-		const double maxVal = *minmax.second;
+// One pass of a centered moving average of 2 * radius + 1 bins, the data is zero beyond the ends
+static void BoxFilter(const vector<double> &input, vector<double> &output, idx_t radius) {
+	const auto size = input.size();
+	const double scale = 1.0 / static_cast<double>(2 * radius + 1);
+	double sum = 0;
+	for (idx_t i = 0; i < std::min(radius, size); i++) {
+		sum += input[i];
+	}
+	for (idx_t i = 0; i < size; i++) {
+		if (i + radius < size) {
+			sum += input[i + radius];
+		}
+		output[i] = sum * scale;
+		if (i >= radius) {
+			sum -= input[i - radius];
+		}
+	}
+}
 
-		if (minVal == maxVal) {
-			// All values are the same - use max density character
-			const auto &maxChar = bind_data.density_chars.back();
-			std::vector<string> output_items(bind_data.width, maxChar);
+// 'smoothed' and 'scratch' are work buffers, their contents are overwritten
+static void AppendDensitySmoothed(const TextplotDensityBindData &bind_data, const vector<idx_t> &fine_bins,
+                                  double range, vector<double> &smoothed, vector<double> &scratch,
+                                  TextplotRender &output_result) {
+	const auto size = fine_bins.size();
+	const double bin_width = range / static_cast<double>(size);
+
+	// Bandwidth in bins, by default from the rule of thumb 1.06 * sd * n^(-1/5) with the sd taken from the bins
+	double sigma;
+	if (bind_data.bandwidth > 0) {
+		sigma = bind_data.bandwidth / bin_width;
+	} else {
+		double n = 0;
+		double sum = 0;
+		double sum_squares = 0;
+		for (idx_t i = 0; i < size; i++) {
+			const double count = static_cast<double>(fine_bins[i]);
+			const double center = static_cast<double>(i) + 0.5;
+			n += count;
+			sum += count * center;
+			sum_squares += count * center * center;
+		}
+		const double mean = n > 0 ? sum / n : 0;
+		const double variance = n > 0 ? std::max(sum_squares / n - mean * mean, 0.0) : 0;
+		sigma = n > 0 ? 1.06 * std::sqrt(variance) * std::pow(n, -0.2) : 0;
+	}
 
-			// Add marker if value matches
-			if (!std::isnan(markerValue) && std::abs(minVal - markerValue) < 1e-10 && !bind_data.marker_char.empty()) {
-				std::fill(output_items.begin(), output_items.end(), bind_data.marker_char);
-			}
+	// Three box filters of width w approximate a Gaussian with variance 3 * (w^2 - 1) / 12
+	const auto box_width = std::sqrt(4 * sigma * sigma + 1);
+	const auto radius = static_cast<idx_t>(std::min(std::round((box_width - 1) / 2), static_cast<double>(size)));
 
-			// Now join all of the items without commas
-			std::string output_result;
-			for (const auto &item : output_items) {
-				output_result += item;
-			}
-			return StringVector::AddString(result, output_result);
+	smoothed.assign(fine_bins.begin(), fine_bins.end());
+	if (radius > 0) {
+		scratch.resize(size);
+		for (int pass = 0; pass < 3; pass++) {
+			BoxFilter(smoothed, scratch, radius);
+			std::swap(smoothed, scratch);
 		}
+	}
 
-		// Create histogram bins
-		std::vector<int> bins(bind_data.width, 0);
-		const double range = maxVal - minVal;
-		const double binWidth = range / bind_data.width;
-
-		// Count values in each bin
-		for (const double val : data_items) {
-			auto binIndex = static_cast<int>((val - minVal) / binWidth);
-			// Clamp to valid range to handle floating point edge cases
-			if (binIndex < 0)
-				binIndex = 0;
-			if (binIndex >= bind_data.width)
-				binIndex = bind_data.width - 1;
-			bins[binIndex]++;
-		}
+	scratch.assign(bind_data.width, 0);
+	for (idx_t i = 0; i < size; i++) {
+		scratch[i / TEXTPLOT_SMOOTH_OVERSAMPLE] += smoothed[i];
+	}
+	AppendDensityBins(bind_data, scratch.data(), -1, output_result);
+}
 
-		// Find max count for scaling
-		const int maxCount = *std::max_element(bins.cbegin(), bins.cend());
-		if (maxCount == 0) {
-			const auto &maxChar = bind_data.density_chars.front();
-			std::string output_result;
-			for (int64_t i = 0; i < bind_data.width; i++) {
-				output_result += maxChar;
-			}
+string TextplotRenderDensityConstant(const TextplotDensityBindData &bind_data) {
+	TextplotRender output_result;
+	AppendDensityConstant(bind_data, output_result);
+	return output_result.ToString();
+}
 
-			return StringVector::AddString(result, output_result);
-		}
+string TextplotRenderDensityBins(const TextplotDensityBindData &bind_data, const vector<idx_t> &bins,
+                                 int64_t marker_pos) {
+	TextplotRender output_result;
+	AppendDensityBins(bind_data, bins.data(), marker_pos, output_result);
+	return output_result.ToString();
+}
+
+string TextplotRenderDensityBins(const TextplotDensityBindData &bind_data, const vector<double> &bins,
+                                 int64_t marker_pos) {
+	TextplotRender output_result;
+	AppendDensityBins(bind_data, bins.data(), marker_pos, output_result);
+	return output_result.ToString();
+}
+
+string TextplotRenderDensitySmoothed(const TextplotDensityBindData &bind_data, const vector<idx_t> &fine_bins,
+                                     double range) {
+	TextplotRender output_result;
+	vector<double> smoothed;
+	vector<double> scratch;
+	AppendDensitySmoothed(bind_data, fine_bins, range, smoothed, scratch, output_result);
+	return output_result.ToString();
+}
+
+// Renders the density plot of one list into 'output_result', the histogram covers [range_min, range_max] when
+// given and the range of the data otherwise. The bins come from the scratch buffers of 'local_state'.
+static void RenderDensity(const TextplotDensityBindData &bind_data, const double *data, idx_t size,
+                          const double *range_min, const double *range_max, TextplotListLocalState &local_state,
+                          TextplotRender &output_result) {
+	double markerValue = std::nan("");
+
+	if (bind_data.width <= 0 || bind_data.density_chars.empty()) {
+		return;
+	}
+
+	// Find min and max values, values outside of the requested range are not counted
+	constexpr double INF = std::numeric_limits<double>::infinity();
+	const auto extent = TextplotExtentKernel(data, size, range_min ? *range_min : -INF, range_max ? *range_max : INF);
+	if (extent.count == 0) {
+		return;
+	}
+	const double minVal = range_min ? *range_min : extent.min;
+	const double maxVal = range_max ? *range_max : extent.max;
 
-		// Determine marker position if specified
-		int markerPos = -1;
-		if (!std::isnan(markerValue) && markerValue >= minVal && markerValue <= maxVal) {
-			markerPos = static_cast<int>((markerValue - minVal) / binWidth);
-			// Clamp to valid range to handle floating point edge cases
-			if (markerPos < 0)
-				markerPos = 0;
-			if (markerPos >= bind_data.width)
-				markerPos = bind_data.width - 1;
+	if (minVal > maxVal) {
+		throw InvalidInputException("tp_density: 'min' must be less than 'max'");
+	}
+
+	if (minVal == maxVal) {
+		// Add marker if value matches
+		if (!std::isnan(markerValue) && std::abs(minVal - markerValue) < 1e-10 && !bind_data.marker_char.empty()) {
+			output_result.Append(bind_data.marker_char, bind_data.width);
+			return;
 		}
+		AppendDensityConstant(bind_data, output_result);
+		return;
+	}
 
-		// Generate ASCII representation using provided character set
-		std::string output_result;
-		const int numLevels = bind_data.density_chars.size() - 1;
+	auto &bins = local_state.bins;
+	if (bind_data.smooth) {
+		bins.assign(bind_data.width * TEXTPLOT_SMOOTH_OVERSAMPLE, 0);
+		TextplotBinKernel(data, size, minVal, maxVal, bins, local_state.histograms);
+		AppendDensitySmoothed(bind_data, bins, maxVal - minVal, local_state.work, local_state.work_other,
+		                      output_result);
+		return;
+	}
 
-		for (int i = 0; i < bind_data.width; i++) {
-			// Check if this position should have a marker
-			if (i == markerPos && !bind_data.marker_char.empty()) {
-				output_result += bind_data.marker_char;
-			} else {
-				// Scale bin count to character range
-				const auto normalized = static_cast<double>(bins[i]) / maxCount;
-				auto charIndex = static_cast<int>(normalized * numLevels + 0.5);
-				charIndex = std::min(charIndex, numLevels);
-				output_result += bind_data.density_chars[charIndex];
-			}
+	// Create histogram bins
+	bins.assign(bind_data.width, 0);
+	TextplotBinKernel(data, size, minVal, maxVal, bins, local_state.histograms);
+
+	// Determine marker position if specified
+	int markerPos = -1;
+	if (!std::isnan(markerValue) && markerValue >= minVal && markerValue <= maxVal) {
+		markerPos = static_cast<int>((markerValue - minVal) / ((maxVal - minVal) / bind_data.width));
+		// Clamp to valid range to handle floating point edge cases
+		if (markerPos < 0)
+			markerPos = 0;
+		if (markerPos >= bind_data.width)
+			markerPos = bind_data.width - 1;
+	}
+
+	AppendDensityBins(bind_data, bins.data(), markerPos, output_result);
+}
+
+void TextplotDensity(DataChunk &args, ExpressionState &state, Vector &result) {
+	const auto &func_expr = state.expr.Cast<BoundFunctionExpression>();
+	const auto &bind_data = func_expr.bind_info->Cast<TextplotDensityBindData>();
+	auto &local_state = TextplotListLocalState::Get(state);
+	const auto count = args.size();
+	TextplotStatsScope stats(state, TextplotStatsFunction::DENSITY);
+
+	TextplotListReader list_reader(args.data[0], count, local_state.elements);
+	const TextplotScaleReader min_reader(bind_data.min, args);
+	const TextplotScaleReader max_reader(bind_data.max, args);
+
+	result.SetVectorType(VectorType::FLAT_VECTOR);
+	auto result_data = FlatVector::GetData<string_t>(result);
+	auto &output = local_state.output;
+	idx_t elements = 0;
+	for (idx_t row = 0; row < count; row++) {
+		if (!list_reader.RowIsValid(row) || min_reader.IsNull(row) || max_reader.IsNull(row)) {
+			FlatVector::SetNull(result, row, true);
+			continue;
 		}
+		double range_min;
+		double range_max;
+		const bool has_min = min_reader.Get(row, range_min);
+		const bool has_max = max_reader.Get(row, range_max);
+
+		idx_t length;
+		const auto values = list_reader.GetSample(row, bind_data.max_samples, true, length);
+		elements += length;
+		output.Clear();
+		RenderDensity(bind_data, values, length, has_min ? &range_min : nullptr, has_max ? &range_max : nullptr,
+		              local_state, output);
+		result_data[row] = output.Write(result);
+	}
 
-		return StringVector::AddString(result, output_result);
-	});
+	if (args.AllConstant()) {
+		result.SetVectorType(VectorType::CONSTANT_VECTOR);
+	}
+	stats.Record(result, count, elements);
 }
 
 } // namespace duckdb
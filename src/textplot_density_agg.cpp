@@ -0,0 +1,128 @@
+#include "textplot_density.hpp"
+#include "textplot_histogram.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/function/aggregate_function.hpp"
+
+namespace duckdb {
+
+struct TextplotDensityAggState {
+	TextplotHistogram *histogram;
+};
+
+struct TextplotDensityAggOperation {
+	template <class STATE>
+	static void Initialize(STATE &state) {
+		state.histogram = nullptr;
+	}
+
+	static TextplotHistogram &GetHistogram(TextplotDensityAggState &state, const TextplotDensityBindData &bind_data) {
+		if (!state.histogram) {
+			if (bind_data.min.is_set && bind_data.max.is_set) {
+				state.histogram = new TextplotHistogram(bind_data.min.value, bind_data.max.value, bind_data.width);
+			} else {
+				// Adaptive range, the bins of the plot are only known once all values are seen
+				state.histogram = new TextplotHistogram();
+			}
+		}
+		return *state.histogram;
+	}
+
+	template <class INPUT_TYPE, class STATE, class OP>
+	static void Operation(STATE &state, const INPUT_TYPE &input, AggregateUnaryInput &unary_input) {
+		const auto &bind_data = unary_input.input.bind_data->Cast<TextplotDensityBindData>();
+		auto &histogram = GetHistogram(state, bind_data);
+		if ((bind_data.min.is_set && input < bind_data.min.value) ||
+		    (bind_data.max.is_set && input > bind_data.max.value)) {
+			return;
+		}
+		histogram.Add(input);
+	}
+
+	template <class INPUT_TYPE, class STATE, class OP>
+	static void ConstantOperation(STATE &state, const INPUT_TYPE &input, AggregateUnaryInput &unary_input,
+	                              idx_t count) {
+		for (idx_t i = 0; i < count; i++) {
+			Operation<INPUT_TYPE, STATE, OP>(state, input, unary_input);
+		}
+	}
+
+	template <class STATE, class OP>
+	static void Combine(const STATE &source, STATE &target, AggregateInputData &aggr_input_data) {
+		if (!source.histogram) {
+			return;
+		}
+		const auto &bind_data = aggr_input_data.bind_data->Cast<TextplotDensityBindData>();
+		GetHistogram(target, bind_data).Combine(*source.histogram);
+	}
+
+	template <class T, class STATE>
+	static void Finalize(STATE &state, T &target, AggregateFinalizeData &finalize_data) {
+		if (!state.histogram) {
+			finalize_data.ReturnNull();
+			return;
+		}
+		const auto &bind_data = finalize_data.input.bind_data->Cast<TextplotDensityBindData>();
+		const auto &histogram = *state.histogram;
+
+		string rendered;
+		if (histogram.Count() > 0) {
+			const double range_min = bind_data.min.is_set ? bind_data.min.value : histogram.Min();
+			const double range_max = bind_data.max.is_set ? bind_data.max.value : histogram.Max();
+			if (range_min == range_max) {
+				rendered = TextplotRenderDensityConstant(bind_data);
+			} else if (bind_data.smooth) {
+				vector<idx_t> fine_bins(bind_data.width * TEXTPLOT_SMOOTH_OVERSAMPLE, 0);
+				histogram.Bin(range_min, range_max, fine_bins);
+				rendered = TextplotRenderDensitySmoothed(bind_data, fine_bins, range_max - range_min);
+			} else {
+				vector<idx_t> bins(bind_data.width, 0);
+				histogram.Bin(range_min, range_max, bins);
+				rendered = TextplotRenderDensityBins(bind_data, bins);
+			}
+		}
+		target = StringVector::AddString(finalize_data.result, rendered);
+	}
+
+	template <class STATE>
+	static void Destroy(STATE &state, AggregateInputData &aggr_input_data) {
+		delete state.histogram;
+		state.histogram = nullptr;
+	}
+
+	static bool IgnoreNull() {
+		return true;
+	}
+};
+
+static unique_ptr<FunctionData> TextplotDensityAggBind(ClientContext &context, AggregateFunction &function,
+                                                       vector<unique_ptr<Expression>> &arguments) {
+	if (arguments.empty()) {
+		throw BinderException("tp_density_agg takes at least one argument");
+	}
+	if (!arguments[0]->return_type.IsNumeric()) {
+		throw InvalidTypeException("tp_density_agg first argument must be numeric");
+	}
+
+	auto bind_data = TextplotDensityBindOptions(context, "tp_density_agg", arguments, 1, false);
+	if (bind_data->max_samples > 0) {
+		throw BinderException("tp_density_agg: 'approx' and 'max_samples' only apply to tp_density");
+	}
+
+	// The options are consumed here, only the value itself is aggregated
+	arguments.erase(arguments.begin() + 1, arguments.end());
+	function.varargs = LogicalType::INVALID;
+	return std::move(bind_data);
+}
+
+AggregateFunction TextplotDensityAggFunction() {
+	auto function = AggregateFunction::UnaryAggregateDestructor<TextplotDensityAggState, double, string_t,
+	                                                            TextplotDensityAggOperation>(LogicalType::DOUBLE,
+	                                                                                         LogicalType::VARCHAR);
+	function.name = "tp_density_agg";
+	function.bind = TextplotDensityAggBind;
+	function.varargs = LogicalType::ANY;
+	function.order_dependent = AggregateOrderDependent::NOT_ORDER_DEPENDENT;
+	return function;
+}
+
+} // namespace duckdb
@@ -1,11 +1,20 @@
 #include "textplot_extension.hpp"
 #include "textplot_bar.hpp"
 #include "textplot_density.hpp"
+#include "textplot_heatmap.hpp"
+#include "textplot_list.hpp"
 #include "textplot_sparkline.hpp"
 #include "textplot_qr.hpp"
+#include "textplot_qr_cache.hpp"
+#include "textplot_stats.hpp"
+#include "textplot_profile.hpp"
 #include "duckdb.hpp"
 #include "duckdb/function/scalar_function.hpp"
+#include "duckdb/function/function_set.hpp"
 #include "duckdb/parser/parsed_data/create_scalar_function_info.hpp"
+#include "duckdb/parser/parsed_data/create_aggregate_function_info.hpp"
+#include "duckdb/parser/parsed_data/create_table_function_info.hpp"
+#include "duckdb/main/config.hpp"
 #include "query_farm_telemetry.hpp"
 
 namespace duckdb {
@@ -26,6 +35,8 @@ static void LoadInternal(ExtensionLoader &loader) {
 		                 "tp_bar(score, min := 0, max := 100, width := 20)",
 		                 "tp_bar(value, on := '#', off := '-', width := 10)",
 		                 "tp_bar(pct, shape := 'heart', on_color := 'red')",
+		                 "tp_bar(cpu, min := min(cpu) OVER (PARTITION BY host), "
+		                 "max := max(cpu) OVER (PARTITION BY host))",
 		                 "tp_bar(temp, thresholds := [{'threshold': 80, 'color': 'red'}, "
 		                 "{'threshold': 50, 'color': 'yellow'}])"};
 		info.descriptions.push_back(std::move(desc));
@@ -36,17 +47,89 @@ static void LoadInternal(ExtensionLoader &loader) {
 
 	// tp_qr: QR code generation
 	{
-		auto qr_function = ScalarFunction("tp_qr", {LogicalType::VARCHAR}, LogicalType::VARCHAR, TextplotQR,
-		                                  TextplotQRBind, nullptr, nullptr, nullptr, LogicalType(LogicalTypeId::ANY));
-		CreateScalarFunctionInfo info(std::move(qr_function));
+		ScalarFunctionSet qr_set("tp_qr");
+		// BLOBs are encoded as bytes as they are, VARCHARs in the most compact mode for their characters
+		for (const auto &type : {LogicalType::VARCHAR, LogicalType::BLOB}) {
+			qr_set.AddFunction(ScalarFunction("tp_qr", {type}, LogicalType::VARCHAR, TextplotQR, TextplotQRBind,
+			                                  nullptr, nullptr, TextplotQRInitLocalState,
+			                                  LogicalType(LogicalTypeId::ANY)));
+		}
+		CreateScalarFunctionInfo info(std::move(qr_set));
 
 		FunctionDescription desc;
 		desc.description = "Generates a text-based QR code from a string or blob. "
 		                   "Supports configurable error correction levels and custom on/off characters.";
-		desc.parameter_names = {"data", "ecc", "on", "off"};
-		desc.examples = {"tp_qr('https://duckdb.org')",
-		                 "tp_qr(url, ecc := 'high')",
-		                 "tp_qr(message, on := '##', off := '  ')"};
+		desc.parameter_names = {"data",        "ecc",         "on",       "off", "style", "mask",
+		                        "min_version", "max_version", "boost_ecc"};
+		desc.examples = {"tp_qr('https://duckdb.org')", "tp_qr(url, ecc := 'high')",
+		                 "tp_qr(message, on := '##', off := '  ')", "tp_qr(url, style := 'half')",
+		                 "tp_qr(url, mask := 0, min_version := 3, max_version := 3)"};
+		info.descriptions.push_back(std::move(desc));
+
+		info.on_conflict = OnCreateConflict::ALTER_ON_CONFLICT;
+		loader.RegisterFunction(std::move(info));
+	}
+
+	// tp_qr_matrix: QR code modules as a bit-packed BLOB
+	{
+		ScalarFunctionSet matrix_set("tp_qr_matrix");
+		for (const auto &type : {LogicalType::VARCHAR, LogicalType::BLOB}) {
+			matrix_set.AddFunction(ScalarFunction("tp_qr_matrix", {type}, LogicalType::BLOB, TextplotQRMatrix,
+			                                      TextplotQRMatrixBind, nullptr, nullptr, TextplotQRInitLocalState,
+			                                      LogicalType(LogicalTypeId::ANY)));
+		}
+		CreateScalarFunctionInfo info(std::move(matrix_set));
+
+		FunctionDescription desc;
+		desc.description = "Encodes a string or blob as a QR code and returns its modules as a BLOB: one byte with "
+		                   "the size followed by the modules row by row, eight per byte starting at the least "
+		                   "significant bit. Draw it with tp_qr_render.";
+		desc.parameter_names = {"data", "ecc", "mask", "min_version", "max_version", "boost_ecc"};
+		desc.examples = {"tp_qr_matrix('https://duckdb.org')", "tp_qr_render(tp_qr_matrix(url), style := 'half')"};
+		info.descriptions.push_back(std::move(desc));
+
+		info.on_conflict = OnCreateConflict::ALTER_ON_CONFLICT;
+		loader.RegisterFunction(std::move(info));
+	}
+
+	// tp_qr_render: Draws a tp_qr_matrix BLOB
+	{
+		auto render_function = ScalarFunction("tp_qr_render", {LogicalType::BLOB}, LogicalType::VARCHAR,
+		                                      TextplotQRRender, TextplotQRRenderBind, nullptr, nullptr,
+		                                      TextplotQRInitLocalState, LogicalType(LogicalTypeId::ANY));
+		CreateScalarFunctionInfo info(std::move(render_function));
+
+		FunctionDescription desc;
+		desc.description = "Draws a QR code returned by tp_qr_matrix as text, with the same options as tp_qr.";
+		desc.parameter_names = {"matrix", "on", "off", "style"};
+		desc.examples = {"tp_qr_render(tp_qr_matrix('https://duckdb.org'))",
+		                 "tp_qr_render(matrix, on := '##', off := '  ')"};
+		info.descriptions.push_back(std::move(desc));
+
+		info.on_conflict = OnCreateConflict::ALTER_ON_CONFLICT;
+		loader.RegisterFunction(std::move(info));
+	}
+
+	// tp_qr_cache_size: Entries of the per-database tp_qr cache, global since every connection shares the cache
+	{
+		auto &config = DBConfig::GetConfig(loader.GetDatabaseInstance());
+		config.AddExtensionOption("tp_qr_cache_size",
+		                          "Number of tp_qr results cached per database, repeated payloads are not encoded "
+		                          "again. 0 disables the cache. Applies to every connection of the database.",
+		                          LogicalType::UBIGINT, Value::UBIGINT(TEXTPLOT_QR_DEFAULT_CACHE_SIZE),
+		                          TextplotQRCacheSizeSetting, SetScope::GLOBAL);
+	}
+
+	// tp_qr_cache_stats: Counters of the tp_qr cache
+	{
+		auto stats_function = ScalarFunction("tp_qr_cache_stats", {}, TextplotQRCacheStatsType(),
+		                                     TextplotQRCacheStatsFunction);
+		stats_function.SetStability(FunctionStability::VOLATILE);
+		CreateScalarFunctionInfo info(std::move(stats_function));
+
+		FunctionDescription desc;
+		desc.description = "Returns the hits, misses, entries and capacity of the tp_qr cache of this database.";
+		desc.examples = {"tp_qr_cache_stats()", "tp_qr_cache_stats().hits"};
 		info.descriptions.push_back(std::move(desc));
 
 		info.on_conflict = OnCreateConflict::ALTER_ON_CONFLICT;
@@ -57,17 +140,20 @@ static void LoadInternal(ExtensionLoader &loader) {
 	{
 		auto density_function =
 		    ScalarFunction("tp_density", {LogicalType::LIST(LogicalType::DOUBLE)}, LogicalType::VARCHAR, TextplotDensity,
-		                   TextplotDensityBind, nullptr, nullptr, nullptr, LogicalType(LogicalTypeId::ANY));
+		                   TextplotDensityBind, nullptr, nullptr, TextplotListLocalState::Init,
+		                   LogicalType(LogicalTypeId::ANY));
 		CreateScalarFunctionInfo info(std::move(density_function));
 
 		FunctionDescription desc;
 		desc.description = "Creates a density plot (histogram) visualization from an array of numeric values. "
 		                   "Supports multiple styles: shaded, dots, ascii, height, circles, safety, rainbow_circle, "
 		                   "rainbow_square, moon, sparse, and white.";
-		desc.parameter_names = {"values", "width", "style", "marker", "graph_chars"};
+		desc.parameter_names = {"values", "width", "style", "marker", "graph_chars",
+		                        "min",    "max",   "smooth", "approx", "max_samples"};
 		desc.examples = {"tp_density(list(value))",
 		                 "tp_density(array_agg(score), width := 40)",
 		                 "tp_density(data, style := 'height')",
+		                 "tp_density(latencies, smooth := true)",
 		                 "tp_density(temps, style := 'rainbow_square', width := 30)"};
 		info.descriptions.push_back(std::move(desc));
 
@@ -75,29 +161,152 @@ static void LoadInternal(ExtensionLoader &loader) {
 		loader.RegisterFunction(std::move(info));
 	}
 
+	// tp_density_agg: Density plots aggregated directly from rows
+	{
+		CreateAggregateFunctionInfo info(TextplotDensityAggFunction());
+
+		FunctionDescription desc;
+		desc.description = "Aggregates numeric values into a density plot (histogram) without first collecting them "
+		                   "into a list. Takes the same options as tp_density; with both 'min' and 'max' given the "
+		                   "bins are counted exactly, otherwise the range adapts to the data.";
+		desc.parameter_names = {"value", "width", "style", "marker", "graph_chars", "min", "max", "smooth"};
+		desc.examples = {"tp_density_agg(latency)",
+		                 "tp_density_agg(latency, min := 0, max := 500) OVER (ORDER BY ts ROWS 1000 PRECEDING)",
+		                 "tp_density_agg(latency, width := 40)",
+		                 "tp_density_agg(score, min := 0, max := 100, style := 'height')"};
+		info.descriptions.push_back(std::move(desc));
+
+		info.on_conflict = OnCreateConflict::ALTER_ON_CONFLICT;
+		loader.RegisterFunction(std::move(info));
+	}
+
+	// tp_heatmap: 2D density plots aggregated from rows
+	{
+		CreateAggregateFunctionInfo info(TextplotHeatmapAggFunction());
+
+		FunctionDescription desc;
+		desc.description = "Aggregates pairs of numeric values into a 2D density plot (heatmap), returned as one "
+		                   "line per row of cells with the highest y values on top. Uses the same styles as "
+		                   "tp_density; x_min/x_max and y_min/y_max fix the range of an axis.";
+		desc.parameter_names = {"x",           "y",     "width", "height", "style",
+		                        "graph_chars", "x_min", "x_max", "y_min",  "y_max"};
+		desc.examples = {"tp_heatmap(hour(ts), latency_ms)", "tp_heatmap(cpu, memory, width := 40, height := 12)",
+		                 "tp_heatmap(x, y, x_min := 0, x_max := 100, style := 'height')"};
+		info.descriptions.push_back(std::move(desc));
+
+		info.on_conflict = OnCreateConflict::ALTER_ON_CONFLICT;
+		loader.RegisterFunction(std::move(info));
+	}
+
 	// tp_sparkline: Compact trend lines with multiple modes
 	{
-		auto sparkline_function = ScalarFunction("tp_sparkline", {LogicalType::LIST(LogicalType::DOUBLE)},
-		                                         LogicalType::VARCHAR, TextplotSparkline, TextplotSparklineBind, nullptr,
-		                                         nullptr, nullptr, LogicalType(LogicalTypeId::ANY));
+		// The first argument is a list or several series of them, TextplotSparklineBind resolves its type
+		auto sparkline_function =
+		    ScalarFunction("tp_sparkline", {LogicalType::ANY}, LogicalType::VARCHAR, TextplotSparkline,
+		                   TextplotSparklineBind, nullptr, nullptr, TextplotListLocalState::Init,
+		                   LogicalType(LogicalTypeId::ANY));
 		CreateScalarFunctionInfo info(std::move(sparkline_function));
 
 		FunctionDescription desc;
 		desc.description = "Creates a sparkline visualization from an array of numeric values. "
 		                   "Supports three modes: 'absolute' (height-based), 'delta' (up/down/same direction), "
-		                   "and 'trend' (direction with magnitude). Multiple themes available per mode.";
-		desc.parameter_names = {"values", "width", "mode", "theme"};
+		                   "and 'trend' (direction with magnitude). Multiple themes available per mode. "
+		                   "A list of lists, or a MAP or STRUCT of lists, is drawn as one sparkline per series "
+		                   "on a shared scale.";
+		desc.parameter_names = {"values", "width", "mode",        "theme",   "min",
+		                        "max",    "approx", "max_samples", "as_list", "labels"};
 		desc.examples = {"tp_sparkline(list(value))",
 		                 "tp_sparkline(array_agg(price), width := 20)",
 		                 "tp_sparkline(data, mode := 'delta', theme := 'arrows')",
 		                 "tp_sparkline(temps, mode := 'absolute', theme := 'utf8_blocks')",
-		                 "tp_sparkline(stocks, mode := 'trend', theme := 'faces')"};
+		                 "tp_sparkline(stocks, mode := 'trend', theme := 'faces')",
+		                 "tp_sparkline(map(hosts, cpu_lists), width := 30)"};
+		info.descriptions.push_back(std::move(desc));
+
+		info.on_conflict = OnCreateConflict::ALTER_ON_CONFLICT;
+		loader.RegisterFunction(std::move(info));
+	}
+
+	// tp_sparkline_agg: Sparklines aggregated directly from rows
+	{
+		CreateAggregateFunctionInfo info(TextplotSparklineAggFunctions());
+
+		FunctionDescription desc;
+		desc.description = "Aggregates values ordered by a timestamp into a sparkline without first collecting them "
+		                   "into a list. Groups of up to 1024 rows render exactly like "
+		                   "tp_sparkline(list(value ORDER BY ts)), larger groups are averaged into 1024 time buckets.";
+		desc.parameter_names = {"value", "ts", "width", "mode", "theme", "min", "max"};
+		desc.examples = {"tp_sparkline_agg(price, ts, width := 30)",
+		                 "tp_sparkline_agg(temperature, day, mode := 'trend', theme := 'arrows')"};
 		info.descriptions.push_back(std::move(desc));
 
 		info.on_conflict = OnCreateConflict::ALTER_ON_CONFLICT;
 		loader.RegisterFunction(std::move(info));
 	}
 
+	// tp_stats_enabled: Whether the tp_* functions count their work for tp_stats()
+	{
+		auto &config = DBConfig::GetConfig(loader.GetDatabaseInstance());
+		config.AddExtensionOption("tp_stats_enabled",
+		                          "Count the rows, input elements, output bytes and time of the tp_* functions for "
+		                          "tp_stats().",
+		                          LogicalType::BOOLEAN, Value::BOOLEAN(true));
+	}
+
+	// tp_stats: Runtime counters of the tp_* functions
+	{
+		CreateTableFunctionInfo info(TextplotStatsTableFunction());
+
+		FunctionDescription desc;
+		desc.description = "Returns the rows rendered, input elements read, output bytes and nanoseconds spent per "
+		                   "tp_* function since the extension was loaded or tp_stats_reset() was called.";
+		desc.examples = {"SELECT * FROM tp_stats()",
+		                 "SELECT function, time_ns / rows AS ns_per_row FROM tp_stats() WHERE rows > 0"};
+		info.descriptions.push_back(std::move(desc));
+
+		info.on_conflict = OnCreateConflict::ALTER_ON_CONFLICT;
+		loader.RegisterFunction(std::move(info));
+	}
+
+	// tp_stats_reset: Clears the counters of tp_stats
+	{
+		CreateTableFunctionInfo info(TextplotStatsResetTableFunction());
+
+		FunctionDescription desc;
+		desc.description = "Sets the counters returned by tp_stats() back to zero.";
+		desc.examples = {"CALL tp_stats_reset()"};
+		info.descriptions.push_back(std::move(desc));
+
+		info.on_conflict = OnCreateConflict::ALTER_ON_CONFLICT;
+		loader.RegisterFunction(std::move(info));
+	}
+
+	// tp_profile: Per-expression work of the last profiled query
+	{
+		CreateTableFunctionInfo info(TextplotProfileTableFunction());
+
+		FunctionDescription desc;
+		desc.description = "Returns the rows, input elements, output bytes, time and tp_qr cache hits of every tp_* "
+		                   "expression of the last query that ran with the query profiler on (PRAGMA "
+		                   "enable_profiling or EXPLAIN ANALYZE).";
+		desc.examples = {"SELECT expression, time_ns FROM tp_profile() ORDER BY time_ns DESC"};
+		info.descriptions.push_back(std::move(desc));
+
+		info.on_conflict = OnCreateConflict::ALTER_ON_CONFLICT;
+		loader.RegisterFunction(std::move(info));
+	}
+
+	// query_farm_telemetry_opt_out: Read by QueryFarmSendTelemetry below, only a value the database was opened with
+	// is seen in time
+	{
+		auto &config = DBConfig::GetConfig(loader.GetDatabaseInstance());
+		config.AddExtensionOption("query_farm_telemetry_opt_out",
+		                          "Do not send the anonymous usage telemetry of Query.Farm extensions when they are "
+		                          "loaded, like the QUERY_FARM_TELEMETRY_OPT_OUT environment variable. Only takes "
+		                          "effect when set in the configuration the database is opened with.",
+		                          LogicalType::BOOLEAN, Value::BOOLEAN(false));
+	}
+
 	QueryFarmSendTelemetry(loader, "textplot", TextplotExtension().Version());
 }
 
@@ -0,0 +1,547 @@
+#include "textplot_heatmap.hpp"
+#include "textplot_density.hpp"
+#include "textplot_histogram.hpp"
+#include "textplot_render.hpp"
+#include "textplot_scale.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/execution/expression_executor.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace duckdb {
+
+struct TextplotHeatmapBindData : public FunctionData {
+	idx_t width = 20;
+	idx_t height = 10;
+	std::vector<std::string> density_chars;
+	// Optional fixed ranges, points outside of them are not counted
+	TextplotScaleBound x_min;
+	TextplotScaleBound x_max;
+	TextplotScaleBound y_min;
+	TextplotScaleBound y_max;
+
+	TextplotHeatmapBindData(idx_t width_p, idx_t height_p, std::vector<std::string> density_chars_p,
+	                        TextplotScaleBound x_min_p, TextplotScaleBound x_max_p, TextplotScaleBound y_min_p,
+	                        TextplotScaleBound y_max_p)
+	    : width(width_p), height(height_p), density_chars(std::move(density_chars_p)), x_min(x_min_p),
+	      x_max(x_max_p), y_min(y_min_p), y_max(y_max_p) {
+	}
+
+	unique_ptr<FunctionData> Copy() const override {
+		return make_uniq<TextplotHeatmapBindData>(width, height, density_chars, x_min, x_max, y_min, y_max);
+	}
+	bool Equals(const FunctionData &other_p) const override {
+		const auto &other = other_p.Cast<TextplotHeatmapBindData>();
+		return width == other.width && height == other.height && density_chars == other.density_chars &&
+		       x_min == other.x_min && x_max == other.x_max && y_min == other.y_min && y_max == other.y_max;
+	}
+};
+
+// One axis of the heatmap grid. A fixed axis has exactly one grid bin per plot cell over the requested range,
+// an adaptive axis has up to four per cell over a range that doubles whenever a value falls outside of it.
+struct TextplotHeatmapAxis {
+	static constexpr idx_t MAX_ADAPTIVE_RESOLUTION = 256;
+
+	bool fixed = false;
+	bool has_lower = false;
+	bool has_upper = false;
+	double range_min = 0;
+	double range_max = 0;
+	idx_t resolution = 0;
+	double lo = 0;
+	double bin_width = 0;
+	// Of the values counted so far
+	double min = 0;
+	double max = 0;
+
+	TextplotHeatmapAxis(idx_t cells, const TextplotScaleBound &lower, const TextplotScaleBound &upper)
+	    : fixed(lower.is_set && upper.is_set), has_lower(lower.is_set), has_upper(upper.is_set),
+	      range_min(lower.is_set ? lower.value : -std::numeric_limits<double>::infinity()),
+	      range_max(upper.is_set ? upper.value : std::numeric_limits<double>::infinity()),
+	      resolution(fixed ? cells : AdaptiveResolution(cells)) {
+		if (fixed) {
+			lo = range_min;
+			bin_width = (range_max - range_min) / resolution;
+		}
+	}
+
+	// Growing halves the bins, so the resolution has to be even
+	static idx_t AdaptiveResolution(idx_t cells) {
+		const auto resolution = std::max(std::min(cells * 4, MAX_ADAPTIVE_RESOLUTION), cells);
+		return resolution + resolution % 2;
+	}
+
+	// The plotted range, a given bound and otherwise the extent of the values
+	double Low() const {
+		return has_lower ? range_min : min;
+	}
+	double High() const {
+		return has_upper ? range_max : max;
+	}
+
+	bool Accepts(double value) const {
+		return value >= range_min && value <= range_max;
+	}
+	bool Covers(double value) const {
+		return fixed || (value >= lo && value < lo + bin_width * resolution);
+	}
+	idx_t Index(double value) const {
+		const double position = (value - lo) / bin_width;
+		if (!(position >= 0)) {
+			return 0;
+		}
+		if (position >= static_cast<double>(resolution - 1)) {
+			return resolution - 1;
+		}
+		return static_cast<idx_t>(position);
+	}
+	// Sets the range of an adaptive axis from the values seen so far, the maximum lands in the last bin
+	void Initialize() {
+		if (fixed) {
+			return;
+		}
+		lo = min;
+		double span = max - min;
+		if (span <= 0) {
+			span = std::max(std::abs(min), 1.0) / resolution;
+		}
+		bin_width = span / (resolution - 1);
+	}
+};
+
+// Bounded-size streaming 2D histogram. Like TextplotHistogram the first PENDING_CAPACITY points are kept
+// exactly, after that they are counted into a grid with one row per y bin.
+class TextplotHeatmapGrid {
+public:
+	static constexpr idx_t PENDING_CAPACITY = 1024;
+
+	explicit TextplotHeatmapGrid(const TextplotHeatmapBindData &bind_data)
+	    : x(bind_data.width, bind_data.x_min, bind_data.x_max), y(bind_data.height, bind_data.y_min, bind_data.y_max) {
+	}
+
+	void Add(double x_value, double y_value) {
+		if (!std::isfinite(x_value) || !std::isfinite(y_value) || !x.Accepts(x_value) || !y.Accepts(y_value)) {
+			return;
+		}
+		if (count == 0) {
+			x.min = x.max = x_value;
+			y.min = y.max = y_value;
+		} else {
+			x.min = std::min(x.min, x_value);
+			x.max = std::max(x.max, x_value);
+			y.min = std::min(y.min, y_value);
+			y.max = std::max(y.max, y_value);
+		}
+		count++;
+
+		if (counts.empty()) {
+			pending.emplace_back(x_value, y_value);
+			if (pending.size() > PENDING_CAPACITY) {
+				BuildGrid();
+			}
+			return;
+		}
+		AddToGrid(x_value, y_value, 1);
+	}
+
+	void Combine(const TextplotHeatmapGrid &other) {
+		if (other.count == 0) {
+			return;
+		}
+		if (other.counts.empty()) {
+			for (const auto &point : other.pending) {
+				Add(point.first, point.second);
+			}
+			return;
+		}
+		if (counts.empty()) {
+			// Adopt the grid of the other side and add the pending points on top
+			auto points = std::move(pending);
+			pending = vector<std::pair<double, double>>();
+			x = other.x;
+			y = other.y;
+			counts = other.counts;
+			count = other.count;
+			for (const auto &point : points) {
+				Add(point.first, point.second);
+			}
+			return;
+		}
+
+		// Both are grids, this one grows to cover the values of the other one, then each bin of the other grid is
+		// split across the bins it overlaps on both axes: first over the rows, then each row's share over the
+		// columns, so that no point is lost to rounding
+		Cover(x, other.x);
+		Cover(y, other.y);
+		const auto x_spans = Spans(other.x, x);
+		const auto y_spans = Spans(other.y, y);
+		vector<idx_t> rows(y.resolution, 0);
+		vector<idx_t> columns(x.resolution, 0);
+		for (idx_t row = 0; row < other.y.resolution; row++) {
+			const auto &y_span = y_spans[row];
+			for (idx_t column = 0; column < other.x.resolution; column++) {
+				const auto n = other.counts[row * other.x.resolution + column];
+				if (n == 0) {
+					continue;
+				}
+				const auto &x_span = x_spans[column];
+				TextplotHistogram::SpreadCount(y_span.first, y_span.last, n, rows);
+				for (auto target_row = y_span.first_bin; target_row <= y_span.last_bin; target_row++) {
+					const auto share = rows[target_row];
+					rows[target_row] = 0;
+					if (share == 0) {
+						continue;
+					}
+					TextplotHistogram::SpreadCount(x_span.first, x_span.last, share, columns);
+					const auto target = counts.data() + target_row * x.resolution;
+					for (auto target_column = x_span.first_bin; target_column <= x_span.last_bin; target_column++) {
+						target[target_column] += columns[target_column];
+						columns[target_column] = 0;
+					}
+				}
+			}
+		}
+		x.min = std::min(x.min, other.x.min);
+		x.max = std::max(x.max, other.x.max);
+		y.min = std::min(y.min, other.y.min);
+		y.max = std::max(y.max, other.y.max);
+		count += other.count;
+	}
+
+	idx_t Count() const {
+		return count;
+	}
+
+	// Counts the points into width × height cells over the range of the data, a given bound replaces that end
+	// of the range. Rows are ordered from the highest y to the lowest. Grid bins are split across the cells
+	// they overlap.
+	void Bin(idx_t width, idx_t height, vector<double> &cells) const {
+		cells.assign(width * height, 0);
+		const double x_low = x.Low();
+		const double x_high = x.High();
+		const double y_low = y.Low();
+		const double y_high = y.High();
+
+		if (counts.empty()) {
+			for (const auto &point : pending) {
+				const auto column = CellIndex(point.first, x_low, x_high, width);
+				const auto row = height - 1 - CellIndex(point.second, y_low, y_high, height);
+				cells[row * width + column] += 1;
+			}
+			return;
+		}
+
+		const auto x_weights = CellWeights(x, x_low, x_high, width);
+		const auto y_weights = CellWeights(y, y_low, y_high, height);
+		for (idx_t row = 0; row < y.resolution; row++) {
+			for (idx_t column = 0; column < x.resolution; column++) {
+				const auto n = counts[row * x.resolution + column];
+				if (n == 0) {
+					continue;
+				}
+				for (const auto &y_weight : y_weights[row]) {
+					const auto cell_row = height - 1 - y_weight.first;
+					for (const auto &x_weight : x_weights[column]) {
+						cells[cell_row * width + x_weight.first] += n * y_weight.second * x_weight.second;
+					}
+				}
+			}
+		}
+	}
+
+private:
+	void BuildGrid() {
+		x.Initialize();
+		y.Initialize();
+		counts.assign(x.resolution * y.resolution, 0);
+		for (const auto &point : pending) {
+			counts[y.Index(point.second) * x.resolution + x.Index(point.first)]++;
+		}
+		pending.clear();
+		pending.shrink_to_fit();
+	}
+
+	void AddToGrid(double x_value, double y_value, idx_t n) {
+		while (!x.Covers(x_value)) {
+			Grow(x, x_value < x.lo);
+		}
+		while (!y.Covers(y_value)) {
+			Grow(y, y_value < y.lo);
+		}
+		counts[y.Index(y_value) * x.resolution + x.Index(x_value)] += n;
+	}
+
+	// Doubles the range of an adaptive axis by merging adjacent bins in place, like TextplotHistogram::Grow
+	void Grow(TextplotHeatmapAxis &axis, bool downward) {
+		const bool is_x = &axis == &x;
+		const auto lines = is_x ? y.resolution : x.resolution;
+		const auto stride = is_x ? 1 : x.resolution;
+		const auto half = axis.resolution / 2;
+		for (idx_t line = 0; line < lines; line++) {
+			const auto data = counts.data() + (is_x ? line * x.resolution : line);
+			if (downward) {
+				for (idx_t i = axis.resolution; i-- > half;) {
+					const auto source = 2 * (i - half);
+					data[i * stride] = data[source * stride] + data[(source + 1) * stride];
+				}
+				for (idx_t i = 0; i < half; i++) {
+					data[i * stride] = 0;
+				}
+			} else {
+				for (idx_t i = 0; i < half; i++) {
+					data[i * stride] = data[2 * i * stride] + data[(2 * i + 1) * stride];
+				}
+				for (idx_t i = half; i < axis.resolution; i++) {
+					data[i * stride] = 0;
+				}
+			}
+		}
+		if (downward) {
+			axis.lo -= axis.bin_width * axis.resolution;
+		}
+		axis.bin_width *= 2;
+	}
+
+	// Grows an adaptive axis until it covers the values counted on another axis
+	void Cover(TextplotHeatmapAxis &axis, const TextplotHeatmapAxis &other) {
+		while (!axis.Covers(other.min)) {
+			Grow(axis, other.min < axis.lo);
+		}
+		while (!axis.Covers(other.max)) {
+			Grow(axis, other.max < axis.lo);
+		}
+	}
+
+	// Where a grid bin of one axis lands on another axis, in units of its bins, and the bins
+	// TextplotHistogram::SpreadCount touches for it
+	struct BinSpan {
+		double first;
+		double last;
+		idx_t first_bin;
+		idx_t last_bin;
+	};
+
+	// For every grid bin of 'source', clamped to the values it counted, its span on 'target'
+	static vector<BinSpan> Spans(const TextplotHeatmapAxis &source, const TextplotHeatmapAxis &target) {
+		vector<BinSpan> spans(source.resolution);
+		const auto limit = static_cast<double>(target.resolution);
+		for (idx_t i = 0; i < source.resolution; i++) {
+			const auto start = std::min(std::max(source.lo + source.bin_width * i, source.min), source.max);
+			const auto end = std::min(std::max(source.lo + source.bin_width * (i + 1), source.min), source.max);
+			auto &span = spans[i];
+			span.first = std::min(std::max((start - target.lo) / target.bin_width, 0.0), limit);
+			span.last = std::min(std::max((end - target.lo) / target.bin_width, 0.0), limit);
+			span.first_bin = std::min(static_cast<idx_t>(span.first), target.resolution - 1);
+			span.last_bin = std::min(static_cast<idx_t>(span.last), target.resolution - 1);
+		}
+		return spans;
+	}
+
+	// The cell of a value on an axis with 'cells' cells over [low, high], a degenerate range maps to the middle
+	static idx_t CellIndex(double value, double low, double high, idx_t cells) {
+		if (!(high > low)) {
+			return cells / 2;
+		}
+		const double position = (value - low) / (high - low) * cells;
+		if (position >= static_cast<double>(cells)) {
+			return cells - 1;
+		}
+		return position > 0 ? static_cast<idx_t>(position) : 0;
+	}
+
+	// For every grid bin of an axis, the cells it overlaps and the share of the bin that falls into each
+	static vector<vector<std::pair<idx_t, double>>> CellWeights(const TextplotHeatmapAxis &axis, double low,
+	                                                            double high, idx_t cells) {
+		vector<vector<std::pair<idx_t, double>>> weights(axis.resolution);
+		for (idx_t i = 0; i < axis.resolution; i++) {
+			const auto start = std::min(std::max(axis.lo + axis.bin_width * i, axis.min), axis.max);
+			const auto end = std::min(std::max(axis.lo + axis.bin_width * (i + 1), axis.min), axis.max);
+			if (!(high > low) || !(end > start)) {
+				weights[i].emplace_back(CellIndex(start, low, high, cells), 1.0);
+				continue;
+			}
+			const double scale = cells / (high - low);
+			const double first = std::max((start - low) * scale, 0.0);
+			const double last = std::min((end - low) * scale, static_cast<double>(cells));
+			if (!(last > first)) {
+				weights[i].emplace_back(CellIndex(start, low, high, cells), 1.0);
+				continue;
+			}
+			for (auto cell = static_cast<idx_t>(first); cell < cells && static_cast<double>(cell) < last; cell++) {
+				const double covered = std::min(last, cell + 1.0) - std::max(first, static_cast<double>(cell));
+				weights[i].emplace_back(cell, covered / (last - first));
+			}
+		}
+		return weights;
+	}
+
+	TextplotHeatmapAxis x;
+	TextplotHeatmapAxis y;
+	idx_t count = 0;
+	// Exact points, only used until the grid is built
+	vector<std::pair<double, double>> pending;
+	// y.resolution rows of x.resolution bins
+	vector<idx_t> counts;
+};
+
+struct TextplotHeatmapState {
+	TextplotHeatmapGrid *grid;
+};
+
+struct TextplotHeatmapOperation {
+	template <class STATE>
+	static void Initialize(STATE &state) {
+		state.grid = nullptr;
+	}
+
+	static TextplotHeatmapGrid &GetGrid(TextplotHeatmapState &state, const TextplotHeatmapBindData &bind_data) {
+		if (!state.grid) {
+			state.grid = new TextplotHeatmapGrid(bind_data);
+		}
+		return *state.grid;
+	}
+
+	template <class A_TYPE, class B_TYPE, class STATE, class OP>
+	static void Operation(STATE &state, const A_TYPE &x, const B_TYPE &y, AggregateBinaryInput &binary_input) {
+		const auto &bind_data = binary_input.input.bind_data->Cast<TextplotHeatmapBindData>();
+		GetGrid(state, bind_data).Add(x, y);
+	}
+
+	template <class STATE, class OP>
+	static void Combine(const STATE &source, STATE &target, AggregateInputData &aggr_input_data) {
+		if (!source.grid) {
+			return;
+		}
+		const auto &bind_data = aggr_input_data.bind_data->Cast<TextplotHeatmapBindData>();
+		GetGrid(target, bind_data).Combine(*source.grid);
+	}
+
+	template <class T, class STATE>
+	static void Finalize(STATE &state, T &target, AggregateFinalizeData &finalize_data) {
+		if (!state.grid) {
+			finalize_data.ReturnNull();
+			return;
+		}
+		const auto &bind_data = finalize_data.input.bind_data->Cast<TextplotHeatmapBindData>();
+		if (state.grid->Count() == 0) {
+			target = StringVector::AddString(finalize_data.result, "");
+			return;
+		}
+
+		vector<double> cells;
+		state.grid->Bin(bind_data.width, bind_data.height, cells);
+		const auto max_cell = *std::max_element(cells.begin(), cells.end());
+		const int levels = static_cast<int>(bind_data.density_chars.size()) - 1;
+
+		TextplotRender output_result;
+		for (idx_t row = 0; row < bind_data.height; row++) {
+			if (row > 0) {
+				output_result.Append("\n", 1);
+			}
+			for (idx_t column = 0; column < bind_data.width; column++) {
+				const auto normalized = max_cell > 0 ? cells[row * bind_data.width + column] / max_cell : 0;
+				const auto level = std::min(static_cast<int>(normalized * levels + 0.5), levels);
+				output_result.Append(bind_data.density_chars[level]);
+			}
+		}
+		target = output_result.Write(finalize_data.result);
+	}
+
+	template <class STATE>
+	static void Destroy(STATE &state, AggregateInputData &aggr_input_data) {
+		delete state.grid;
+		state.grid = nullptr;
+	}
+
+	static bool IgnoreNull() {
+		return true;
+	}
+};
+
+static unique_ptr<FunctionData> TextplotHeatmapBind(ClientContext &context, AggregateFunction &function,
+                                                    vector<unique_ptr<Expression>> &arguments) {
+	if (arguments.size() < 2) {
+		throw BinderException("tp_heatmap takes at least two arguments");
+	}
+	if (!arguments[0]->return_type.IsNumeric() || !arguments[1]->return_type.IsNumeric()) {
+		throw InvalidTypeException("tp_heatmap x and y arguments must be numeric");
+	}
+
+	int64_t width = 20;
+	int64_t height = 10;
+	string style = "shaded";
+	std::vector<std::string> graph_characters;
+	TextplotScaleBound x_min;
+	TextplotScaleBound x_max;
+	TextplotScaleBound y_min;
+	TextplotScaleBound y_max;
+
+	for (idx_t i = 2; i < arguments.size(); i++) {
+		const auto &arg = arguments[i];
+		if (arg->HasParameter()) {
+			throw ParameterNotResolvedException();
+		}
+		if (!arg->IsFoldable()) {
+			throw BinderException("tp_heatmap: arguments must be constant");
+		}
+		const auto alias = arg->GetAlias();
+		if (alias == "width" || alias == "height") {
+			if (!arg->return_type.IsIntegral()) {
+				throw BinderException(StringUtil::Format("tp_heatmap: '%s' argument must be an integer", alias));
+			}
+			const auto eval_result = ExpressionExecutor::EvaluateScalar(context, *arg);
+			auto &size = alias == "width" ? width : height;
+			size = eval_result.CastAs(context, LogicalType::BIGINT).GetValue<int64_t>();
+		} else if (alias == "style") {
+			if (arg->return_type.id() != LogicalTypeId::VARCHAR) {
+				throw BinderException("tp_heatmap: 'style' argument must be a VARCHAR");
+			}
+			style = StringValue::Get(ExpressionExecutor::EvaluateScalar(context, *arg));
+		} else if (alias == "graph_chars") {
+			if (arg->return_type != LogicalType::LIST(LogicalType::VARCHAR)) {
+				throw BinderException("tp_heatmap: 'graph_chars' argument must be a list of strings");
+			}
+			for (const auto &list_item : ListValue::GetChildren(ExpressionExecutor::EvaluateScalar(context, *arg))) {
+				graph_characters.push_back(StringValue::Get(list_item));
+			}
+		} else if (alias == "x_min" || alias == "x_max" || alias == "y_min" || alias == "y_max") {
+			auto &bound = alias == "x_min" ? x_min : alias == "x_max" ? x_max : alias == "y_min" ? y_min : y_max;
+			bound = TextplotBindScaleBound(context, "tp_heatmap", alias, arguments, i);
+		} else {
+			throw BinderException(StringUtil::Format("tp_heatmap: Unknown argument '%s'", alias));
+		}
+	}
+
+	if (graph_characters.empty()) {
+		graph_characters = TextplotDensityStyle("tp_heatmap", style);
+	} else if (graph_characters.size() < 2) {
+		throw BinderException("tp_heatmap: 'graph_chars' needs at least two characters");
+	}
+	if (width < 1 || height < 1) {
+		throw BinderException("tp_heatmap: 'width' and 'height' arguments must be at least 1");
+	}
+	if ((x_min.is_set && x_max.is_set && x_min.value >= x_max.value) ||
+	    (y_min.is_set && y_max.is_set && y_min.value >= y_max.value)) {
+		throw BinderException("tp_heatmap: 'x_min'/'y_min' must be less than 'x_max'/'y_max'");
+	}
+
+	// The options are consumed here, only x and y are aggregated
+	arguments.erase(arguments.begin() + 2, arguments.end());
+	function.varargs = LogicalType::INVALID;
+	return make_uniq<TextplotHeatmapBindData>(width, height, graph_characters, x_min, x_max, y_min, y_max);
+}
+
+AggregateFunction TextplotHeatmapAggFunction() {
+	auto function =
+	    AggregateFunction::BinaryAggregate<TextplotHeatmapState, double, double, string_t, TextplotHeatmapOperation>(
+	        LogicalType::DOUBLE, LogicalType::DOUBLE, LogicalType::VARCHAR);
+	function.name = "tp_heatmap";
+	function.bind = TextplotHeatmapBind;
+	function.destructor = AggregateFunction::StateDestroy<TextplotHeatmapState, TextplotHeatmapOperation>;
+	function.varargs = LogicalType::ANY;
+	function.order_dependent = AggregateOrderDependent::NOT_ORDER_DEPENDENT;
+	return function;
+}
+
+} // namespace duckdb
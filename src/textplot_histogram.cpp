@@ -0,0 +1,218 @@
+#include "textplot_histogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace duckdb {
+
+TextplotHistogram::TextplotHistogram(double range_min, double range_max, idx_t bin_count)
+    : fixed(true), counts(bin_count, 0), lo(range_min), hi(range_max), bin_width((range_max - range_min) / bin_count) {
+}
+
+void TextplotHistogram::Add(double value) {
+	if (!std::isfinite(value)) {
+		return;
+	}
+	if (fixed) {
+		if (value < lo || value > hi) {
+			return;
+		}
+		auto index = static_cast<idx_t>((value - lo) / bin_width);
+		counts[std::min(index, counts.size() - 1)]++;
+	}
+
+	if (count == 0) {
+		min = value;
+		max = value;
+	} else {
+		min = std::min(min, value);
+		max = std::max(max, value);
+	}
+	count++;
+
+	if (fixed) {
+		return;
+	}
+	if (counts.empty()) {
+		pending.push_back(value);
+		if (pending.size() > PENDING_CAPACITY) {
+			BuildGrid();
+		}
+		return;
+	}
+	AddToGrid(value, 1);
+}
+
+void TextplotHistogram::BuildGrid() {
+	lo = min;
+	double span = max - min;
+	if (span <= 0) {
+		span = std::max(std::abs(min), 1.0) / RESOLUTION;
+	}
+	// The maximum lands in the last bin
+	bin_width = span / (RESOLUTION - 1);
+	counts.assign(RESOLUTION, 0);
+	for (const auto value : pending) {
+		counts[GridIndex(value)]++;
+	}
+	pending.clear();
+	pending.shrink_to_fit();
+}
+
+idx_t TextplotHistogram::GridIndex(double value) const {
+	const double position = (value - lo) / bin_width;
+	if (!(position >= 0)) {
+		return 0;
+	}
+	if (position >= static_cast<double>(RESOLUTION - 1)) {
+		return RESOLUTION - 1;
+	}
+	return static_cast<idx_t>(position);
+}
+
+void TextplotHistogram::AddToGrid(double value, idx_t n) {
+	while (value < lo) {
+		Grow(true);
+	}
+	while (value >= lo + bin_width * RESOLUTION) {
+		Grow(false);
+	}
+	counts[GridIndex(value)] += n;
+}
+
+// Doubles the range of the grid by merging adjacent bins, in place. Growing downward moves the
+// merged bins to the upper half.
+void TextplotHistogram::Grow(bool downward) {
+	constexpr idx_t HALF = RESOLUTION / 2;
+	if (downward) {
+		for (idx_t i = RESOLUTION; i-- > HALF;) {
+			const auto source = 2 * (i - HALF);
+			counts[i] = counts[source] + counts[source + 1];
+		}
+		std::fill(counts.begin(), counts.begin() + HALF, 0);
+		lo -= bin_width * RESOLUTION;
+	} else {
+		for (idx_t i = 0; i < HALF; i++) {
+			counts[i] = counts[2 * i] + counts[2 * i + 1];
+		}
+		std::fill(counts.begin() + HALF, counts.end(), 0);
+	}
+	bin_width *= 2;
+}
+
+// The split is done on the cumulative count so that no value is lost to rounding
+void TextplotHistogram::SpreadCount(double first, double last, idx_t n, vector<idx_t> &bins) {
+	const auto bin_count = bins.size();
+	const auto limit = static_cast<double>(bin_count);
+	first = std::min(std::max(first, 0.0), limit);
+	last = std::min(std::max(last, 0.0), limit);
+	const auto first_index = std::min(static_cast<idx_t>(first), bin_count - 1);
+	const auto last_index = std::min(static_cast<idx_t>(last), bin_count - 1);
+	if (!(last - first > 0) || first_index == last_index) {
+		bins[first_index] += n;
+		return;
+	}
+	idx_t assigned = 0;
+	for (auto index = first_index; index <= last_index; index++) {
+		const double covered = std::min(last, static_cast<double>(index + 1)) - first;
+		auto share = static_cast<idx_t>(std::llround(n * std::min(covered / (last - first), 1.0)));
+		share = std::min(share, n) - assigned;
+		bins[index] += share;
+		assigned += share;
+	}
+	bins[last_index] += n - assigned;
+}
+
+void TextplotHistogram::Combine(const TextplotHistogram &other) {
+	if (other.count == 0) {
+		return;
+	}
+	if (fixed || (!counts.empty() && !other.counts.empty())) {
+		if (fixed) {
+			// Fixed histograms of the same aggregate always share their bins
+			for (idx_t i = 0; i < counts.size(); i++) {
+				counts[i] += other.counts[i];
+			}
+		} else {
+			// Both are grids, re-bin the other grid into this one, splitting its bins by overlap
+			while (other.min < lo) {
+				Grow(true);
+			}
+			while (other.max >= lo + bin_width * RESOLUTION) {
+				Grow(false);
+			}
+			for (idx_t i = 0; i < other.counts.size(); i++) {
+				if (other.counts[i] == 0) {
+					continue;
+				}
+				const auto start = std::min(std::max(other.lo + other.bin_width * i, other.min), other.max);
+				const auto end = std::min(std::max(other.lo + other.bin_width * (i + 1), other.min), other.max);
+				SpreadCount((start - lo) / bin_width, (end - lo) / bin_width, other.counts[i], counts);
+			}
+		}
+		min = count == 0 ? other.min : std::min(min, other.min);
+		max = count == 0 ? other.max : std::max(max, other.max);
+		count += other.count;
+		return;
+	}
+
+	if (other.counts.empty()) {
+		for (const auto value : other.pending) {
+			Add(value);
+		}
+		return;
+	}
+
+	// Only the other histogram has a grid, adopt it and add the pending values on top
+	auto values = std::move(pending);
+	pending = vector<double>();
+	counts = other.counts;
+	lo = other.lo;
+	bin_width = other.bin_width;
+	count = other.count;
+	min = other.min;
+	max = other.max;
+	for (const auto value : values) {
+		Add(value);
+	}
+}
+
+void TextplotHistogram::Bin(double range_min, double range_max, vector<idx_t> &bins) const {
+	std::fill(bins.begin(), bins.end(), 0);
+	if (bins.empty()) {
+		return;
+	}
+	const auto bin_count = bins.size();
+	const double out_width = (range_max - range_min) / bin_count;
+	const auto place = [&](double value, idx_t n) {
+		const double position = (value - range_min) / out_width;
+		idx_t index = 0;
+		if (position >= static_cast<double>(bin_count)) {
+			index = bin_count - 1;
+		} else if (position > 0) {
+			index = static_cast<idx_t>(position);
+		}
+		bins[index] += n;
+	};
+
+	if (counts.empty()) {
+		for (const auto value : pending) {
+			place(value, 1);
+		}
+		return;
+	}
+	if (fixed && bin_count == counts.size() && range_min == lo && range_max == hi) {
+		std::copy(counts.begin(), counts.end(), bins.begin());
+		return;
+	}
+	// Internal bins that straddle output bins are split by overlap
+	for (idx_t i = 0; i < counts.size(); i++) {
+		if (counts[i] == 0) {
+			continue;
+		}
+		const auto start = std::min(std::max(lo + bin_width * i, min), max);
+		const auto end = std::min(std::max(lo + bin_width * (i + 1), min), max);
+		SpreadCount((start - range_min) / out_width, (end - range_min) / out_width, counts[i], bins);
+	}
+}
+
+} // namespace duckdb
@@ -0,0 +1,214 @@
+#include "textplot_kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace duckdb {
+
+// Independent accumulators, so the reduction is not one long dependency chain
+static constexpr idx_t EXTENT_LANES = 8;
+// Values whose bin index is computed at once
+static constexpr idx_t BIN_BLOCK = 512;
+// Sorted or clustered input puts runs of values in the same bin, spreading consecutive values
+// over separate histograms keeps each increment from waiting on the previous store
+static constexpr idx_t SUB_HISTOGRAMS = 4;
+
+template <bool BOUNDED>
+static TextplotExtent ExtentLoop(const double *data, idx_t count, double lower, double upper) {
+	constexpr double INF = std::numeric_limits<double>::infinity();
+	double mins[EXTENT_LANES];
+	double maxs[EXTENT_LANES];
+	// Counted as doubles, which keeps every lane the same width and is exact up to 2^53
+	double counts[EXTENT_LANES];
+	for (idx_t k = 0; k < EXTENT_LANES; k++) {
+		mins[k] = INF;
+		maxs[k] = -INF;
+		counts[k] = 0;
+	}
+
+	// Only compares and selects, NaN never wins a comparison so it never becomes the minimum or maximum.
+	// With bounds, out of bounds values are first replaced by the neutral element.
+	idx_t i = 0;
+	for (; i + EXTENT_LANES <= count; i += EXTENT_LANES) {
+		for (idx_t k = 0; k < EXTENT_LANES; k++) {
+			const double value = data[i + k];
+			double low = value;
+			double high = value;
+			if (BOUNDED) {
+				low = value >= lower ? value : INF;
+				low = low <= upper ? low : INF;
+				high = value <= upper ? value : -INF;
+				high = high >= lower ? high : -INF;
+				counts[k] += value >= lower && value <= upper ? 1.0 : 0.0;
+			} else {
+				counts[k] += value == value ? 1.0 : 0.0;
+			}
+			mins[k] = low < mins[k] ? low : mins[k];
+			maxs[k] = high > maxs[k] ? high : maxs[k];
+		}
+	}
+
+	TextplotExtent result {INF, -INF, 0};
+	for (; i < count; i++) {
+		const double value = data[i];
+		if (value >= lower && value <= upper) {
+			result.min = std::min(result.min, value);
+			result.max = std::max(result.max, value);
+			result.count++;
+		}
+	}
+	for (idx_t k = 0; k < EXTENT_LANES; k++) {
+		result.min = std::min(result.min, mins[k]);
+		result.max = std::max(result.max, maxs[k]);
+		result.count += static_cast<idx_t>(counts[k]);
+	}
+	return result;
+}
+
+TextplotExtent TextplotExtentKernel(const double *data, idx_t count, double lower, double upper) {
+	constexpr double INF = std::numeric_limits<double>::infinity();
+	if (lower == -INF && upper == INF) {
+		return ExtentLoop<false>(data, count, lower, upper);
+	}
+	return ExtentLoop<true>(data, count, lower, upper);
+}
+
+void TextplotBinKernel(const double *data, idx_t count, double range_min, double range_max, vector<idx_t> &bins,
+                       vector<idx_t> &scratch) {
+	const auto bin_count = bins.size();
+	if (bin_count == 0) {
+		return;
+	}
+	// Multiply by the reciprocal of the bin width instead of dividing every value
+	const double scale = static_cast<double>(bin_count) / (range_max - range_min);
+	const double last_bin = static_cast<double>(bin_count - 1);
+	// Skipped values are counted into one extra slot that is dropped at the end
+	const double overflow_bin = static_cast<double>(bin_count);
+	const auto stride = bin_count + 1;
+
+	auto &histograms = scratch;
+	histograms.assign(SUB_HISTOGRAMS * stride, 0);
+	int32_t indices[BIN_BLOCK];
+
+	for (idx_t start = 0; start < count; start += BIN_BLOCK) {
+		const auto block = std::min(BIN_BLOCK, count - start);
+		const auto values = data + start;
+		for (idx_t i = 0; i < block; i++) {
+			const double value = values[i];
+			const bool in_range = (value >= range_min) & (value <= range_max);
+			double position = (value - range_min) * scale;
+			// Written so that NaN ends up clamped rather than converted
+			position = position < last_bin ? position : last_bin;
+			position = position > 0 ? position : 0;
+			position = in_range ? position : overflow_bin;
+			indices[i] = static_cast<int32_t>(position);
+		}
+
+		idx_t i = 0;
+		for (; i + SUB_HISTOGRAMS <= block; i += SUB_HISTOGRAMS) {
+			for (idx_t k = 0; k < SUB_HISTOGRAMS; k++) {
+				histograms[k * stride + indices[i + k]]++;
+			}
+		}
+		for (; i < block; i++) {
+			histograms[indices[i]]++;
+		}
+	}
+
+	for (idx_t k = 0; k < SUB_HISTOGRAMS; k++) {
+		const auto histogram = histograms.data() + k * stride;
+		for (idx_t b = 0; b < bin_count; b++) {
+			bins[b] += histogram[b];
+		}
+	}
+}
+
+TextplotExtent TextplotBucketMeanKernel(const double *data, idx_t size, idx_t width, double *means) {
+	constexpr double INF = std::numeric_limits<double>::infinity();
+	double mins[EXTENT_LANES];
+	double maxs[EXTENT_LANES];
+	double counts[EXTENT_LANES];
+	for (idx_t k = 0; k < EXTENT_LANES; k++) {
+		mins[k] = INF;
+		maxs[k] = -INF;
+		counts[k] = 0;
+	}
+
+	// The bucket bounds of generateAbsoluteSparkline, the sums and the extent are taken in the same pass
+	const double per_bucket = static_cast<double>(size) / width;
+	for (idx_t bucket = 0; bucket < width; bucket++) {
+		const auto start = std::min(static_cast<idx_t>(bucket * per_bucket), size - 1);
+		const auto end = std::max(std::min(static_cast<idx_t>((bucket + 1) * per_bucket), size), start + 1);
+
+		double sums[EXTENT_LANES] = {};
+		idx_t i = start;
+		for (; i + EXTENT_LANES <= end; i += EXTENT_LANES) {
+			for (idx_t k = 0; k < EXTENT_LANES; k++) {
+				const double value = data[i + k];
+				sums[k] += value;
+				mins[k] = value < mins[k] ? value : mins[k];
+				maxs[k] = value > maxs[k] ? value : maxs[k];
+				counts[k] += value == value ? 1.0 : 0.0;
+			}
+		}
+		double sum = 0;
+		for (; i < end; i++) {
+			const double value = data[i];
+			sum += value;
+			mins[0] = value < mins[0] ? value : mins[0];
+			maxs[0] = value > maxs[0] ? value : maxs[0];
+			counts[0] += value == value ? 1.0 : 0.0;
+		}
+		for (idx_t k = 0; k < EXTENT_LANES; k++) {
+			sum += sums[k];
+		}
+		means[bucket] = sum / static_cast<double>(end - start);
+	}
+
+	TextplotExtent result {INF, -INF, 0};
+	for (idx_t k = 0; k < EXTENT_LANES; k++) {
+		result.min = std::min(result.min, mins[k]);
+		result.max = std::max(result.max, maxs[k]);
+		result.count += static_cast<idx_t>(counts[k]);
+	}
+	return result;
+}
+
+void TextplotLevelKernel(const double *values, idx_t count, double min, double max, int32_t max_level,
+                         int32_t *levels) {
+	const double scale = max_level / (max - min);
+	const double top = static_cast<double>(max_level);
+	for (idx_t i = 0; i < count; i++) {
+		// Rounds half away from zero like std::round for the non-negative positions that are kept
+		double position = (values[i] - min) * scale + 0.5;
+		position = position < top ? position : top;
+		position = position > 0 ? position : 0;
+		levels[i] = static_cast<int32_t>(position);
+	}
+}
+
+idx_t TextplotChangeMagnitudeKernel(const double *data, idx_t size, double *magnitudes) {
+	idx_t zeros = 0;
+	for (idx_t i = 0; i + 1 < size; i++) {
+		const double magnitude = std::abs(data[i + 1] - data[i]);
+		const bool significant = magnitude > TEXTPLOT_CHANGE_EPSILON;
+		magnitudes[i] = significant ? magnitude : 0.0;
+		zeros += !significant;
+	}
+	return zeros;
+}
+
+void TextplotChangeLevelKernel(const double *data, idx_t size, idx_t width, double threshold, int32_t *levels) {
+	const double per_cell = static_cast<double>(size - 1) / width;
+	const auto last = size - 2;
+	for (idx_t i = 0; i < width; i++) {
+		auto index = static_cast<idx_t>(i * per_cell);
+		index = index < last ? index : last;
+		const double change = data[index + 1] - data[index];
+		const int32_t sign = (change > TEXTPLOT_CHANGE_EPSILON) - (change < -TEXTPLOT_CHANGE_EPSILON);
+		const int32_t large = std::abs(change) > threshold;
+		levels[i] = 2 + sign * (1 + large);
+	}
+}
+
+} // namespace duckdb
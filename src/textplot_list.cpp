@@ -0,0 +1,236 @@
+#include "textplot_list.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/execution/expression_executor.hpp"
+#include <cmath>
+
+namespace duckdb {
+
+// DECIMAL stored as HUGEINT and the other wide types go through the regular cast
+static bool IsNativeListChild(const LogicalType &type) {
+	switch (type.id()) {
+	case LogicalTypeId::TINYINT:
+	case LogicalTypeId::SMALLINT:
+	case LogicalTypeId::INTEGER:
+	case LogicalTypeId::BIGINT:
+	case LogicalTypeId::UTINYINT:
+	case LogicalTypeId::USMALLINT:
+	case LogicalTypeId::UINTEGER:
+	case LogicalTypeId::UBIGINT:
+	case LogicalTypeId::FLOAT:
+	case LogicalTypeId::DOUBLE:
+		return true;
+	case LogicalTypeId::DECIMAL:
+		return type.InternalType() != PhysicalType::INT128;
+	default:
+		return false;
+	}
+}
+
+void TextplotBindNumericList(ScalarFunction &bound_function, const vector<unique_ptr<Expression>> &arguments,
+                             idx_t index) {
+	const auto &type = arguments[index]->return_type;
+	if (type.id() == LogicalTypeId::LIST && IsNativeListChild(ListType::GetChildType(type))) {
+		bound_function.arguments[index] = type;
+	}
+}
+
+LogicalType TextplotNumericListType(const LogicalType &type) {
+	LogicalType child_type;
+	if (type.id() == LogicalTypeId::LIST) {
+		child_type = ListType::GetChildType(type);
+	} else if (type.id() == LogicalTypeId::ARRAY) {
+		child_type = ArrayType::GetChildType(type);
+	} else {
+		return LogicalType::INVALID;
+	}
+	if (child_type.id() == LogicalTypeId::SQLNULL) {
+		// Untyped, e.g. []
+		return LogicalType::LIST(LogicalType::DOUBLE);
+	}
+	if (!child_type.IsNumeric()) {
+		return LogicalType::INVALID;
+	}
+	return LogicalType::LIST(IsNativeListChild(child_type) ? child_type : LogicalType::DOUBLE);
+}
+
+bool TextplotBindSampling(ClientContext &context, const string &function_name, const string &alias,
+                          Expression &arg, idx_t &max_samples) {
+	if (alias == "approx") {
+		if (arg.return_type.id() != LogicalTypeId::BOOLEAN) {
+			throw BinderException(StringUtil::Format("%s: 'approx' argument must be a BOOLEAN", function_name));
+		}
+		const auto value = ExpressionExecutor::EvaluateScalar(context, arg);
+		if (value.IsNull() || !BooleanValue::Get(value)) {
+			max_samples = 0;
+		} else if (max_samples == 0) {
+			max_samples = TEXTPLOT_DEFAULT_MAX_SAMPLES;
+		}
+		return true;
+	}
+	if (alias == "max_samples") {
+		if (!arg.return_type.IsIntegral()) {
+			throw BinderException(StringUtil::Format("%s: 'max_samples' argument must be an integer", function_name));
+		}
+		const auto value = ExpressionExecutor::EvaluateScalar(context, arg);
+		const auto samples = value.IsNull() ? 0 : value.CastAs(context, LogicalType::BIGINT).GetValue<int64_t>();
+		if (samples < 1) {
+			throw BinderException(StringUtil::Format("%s: 'max_samples' argument must be at least 1", function_name));
+		}
+		max_samples = samples;
+		return true;
+	}
+	return false;
+}
+
+template <class T>
+static void ConvertRow(const UnifiedVectorFormat &format, const list_entry_t &entry, double divisor,
+                       vector<double> &result) {
+	const auto data = UnifiedVectorFormat::GetData<T>(format);
+	result.clear();
+	if (!format.sel->IsSet() && format.validity.CheckAllValid(entry.offset + entry.length, entry.offset)) {
+		// Plain conversion loop, this vectorizes
+		result.resize(entry.length);
+		const auto source = data + entry.offset;
+		for (idx_t i = 0; i < entry.length; i++) {
+			result[i] = static_cast<double>(source[i]);
+		}
+	} else {
+		result.reserve(entry.length);
+		for (idx_t i = entry.offset; i < entry.offset + entry.length; i++) {
+			const auto idx = format.sel->get_index(i);
+			if (format.validity.RowIsValid(idx)) {
+				result.push_back(static_cast<double>(data[idx]));
+			}
+		}
+	}
+	if (divisor != 1) {
+		for (auto &value : result) {
+			value /= divisor;
+		}
+	}
+}
+
+// Cheap deterministic hash, picks the element within each stratum so that the same list always gives the same plot
+static idx_t StratumHash(idx_t stratum) {
+	uint64_t x = stratum + 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+template <class T>
+static void SampleRow(const UnifiedVectorFormat &format, const list_entry_t &entry, double divisor,
+                      idx_t max_samples, bool jitter, vector<double> &result) {
+	const auto data = UnifiedVectorFormat::GetData<T>(format);
+	result.clear();
+	result.reserve(max_samples);
+	for (idx_t stratum = 0; stratum < max_samples; stratum++) {
+		const auto start = entry.length * stratum / max_samples;
+		const auto end = entry.length * (stratum + 1) / max_samples;
+		const auto position = jitter ? start + StratumHash(stratum) % (end - start) : start + (end - start) / 2;
+		const auto idx = format.sel->get_index(entry.offset + position);
+		if (format.validity.RowIsValid(idx)) {
+			result.push_back(static_cast<double>(data[idx]) / divisor);
+		}
+	}
+}
+
+template <class T>
+void TextplotListReader::SetElementType() {
+	convert_row = ConvertRow<T>;
+	sample_row = SampleRow<T>;
+}
+
+unique_ptr<FunctionLocalState> TextplotListLocalState::Init(ExpressionState &state, const BoundFunctionExpression &expr,
+                                                            FunctionData *bind_data) {
+	return make_uniq<TextplotListLocalState>();
+}
+
+TextplotListLocalState &TextplotListLocalState::Get(ExpressionState &state) {
+	return ExecuteFunctionState::GetFunctionState(state)->Cast<TextplotListLocalState>();
+}
+
+TextplotListReader::TextplotListReader(Vector &list_vector, idx_t count, vector<double> &scratch_p)
+    : scratch(scratch_p) {
+	list_vector.ToUnifiedFormat(count, list_format);
+	entries = UnifiedVectorFormat::GetData<list_entry_t>(list_format);
+
+	auto &child = ListVector::GetEntry(list_vector);
+	child.ToUnifiedFormat(ListVector::GetListSize(list_vector), child_format);
+
+	const auto &child_type = child.GetType();
+	switch (child_type.id()) {
+	case LogicalTypeId::TINYINT:
+		SetElementType<int8_t>();
+		break;
+	case LogicalTypeId::SMALLINT:
+		SetElementType<int16_t>();
+		break;
+	case LogicalTypeId::INTEGER:
+		SetElementType<int32_t>();
+		break;
+	case LogicalTypeId::BIGINT:
+		SetElementType<int64_t>();
+		break;
+	case LogicalTypeId::UTINYINT:
+		SetElementType<uint8_t>();
+		break;
+	case LogicalTypeId::USMALLINT:
+		SetElementType<uint16_t>();
+		break;
+	case LogicalTypeId::UINTEGER:
+		SetElementType<uint32_t>();
+		break;
+	case LogicalTypeId::UBIGINT:
+		SetElementType<uint64_t>();
+		break;
+	case LogicalTypeId::FLOAT:
+		SetElementType<float>();
+		break;
+	case LogicalTypeId::DOUBLE:
+		SetElementType<double>();
+		in_place = !child_format.sel->IsSet();
+		break;
+	case LogicalTypeId::DECIMAL:
+		divisor = std::pow(10.0, DecimalType::GetScale(child_type));
+		switch (child_type.InternalType()) {
+		case PhysicalType::INT16:
+			SetElementType<int16_t>();
+			break;
+		case PhysicalType::INT32:
+			SetElementType<int32_t>();
+			break;
+		case PhysicalType::INT64:
+			SetElementType<int64_t>();
+			break;
+		default:
+			throw InternalException("TextplotListReader: unsupported DECIMAL storage %s", child_type.ToString());
+		}
+		break;
+	default:
+		throw InternalException("TextplotListReader: unsupported list child type %s", child_type.ToString());
+	}
+}
+
+const double *TextplotListReader::GetRow(idx_t row, idx_t &length) {
+	const auto &entry = entries[list_format.sel->get_index(row)];
+	if (in_place && child_format.validity.CheckAllValid(entry.offset + entry.length, entry.offset)) {
+		length = entry.length;
+		return UnifiedVectorFormat::GetData<double>(child_format) + entry.offset;
+	}
+	convert_row(child_format, entry, divisor, scratch);
+	length = scratch.size();
+	return scratch.data();
+}
+
+const double *TextplotListReader::GetSample(idx_t row, idx_t max_samples, bool jitter, idx_t &length) {
+	const auto &entry = entries[list_format.sel->get_index(row)];
+	if (max_samples == 0 || entry.length <= max_samples) {
+		return GetRow(row, length);
+	}
+	sample_row(child_format, entry, divisor, max_samples, jitter, scratch);
+	length = scratch.size();
+	return scratch.data();
+}
+
+} // namespace duckdb
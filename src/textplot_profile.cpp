@@ -0,0 +1,97 @@
+#include "textplot_profile.hpp"
+#include "duckdb/main/client_context.hpp"
+
+namespace duckdb {
+
+TextplotProfileState &TextplotProfileState::Get(ClientContext &context) {
+	return *context.registered_state->GetOrCreate<TextplotProfileState>("textplot_profile");
+}
+
+void TextplotProfileState::Record(const Expression &expr, TextplotStatsFunction function,
+                                  const TextplotStatsValues &values, idx_t cache_hits, idx_t cache_misses) {
+	lock_guard<mutex> guard(lock);
+	auto index = current_index.find(&expr);
+	if (index == current_index.end()) {
+		Entry entry;
+		entry.expression = expr.ToString();
+		entry.alias = expr.GetAlias();
+		entry.function = function;
+		index = current_index.emplace(&expr, current.size()).first;
+		current.push_back(std::move(entry));
+	}
+	auto &entry = current[index->second];
+	entry.values.rows += values.rows;
+	entry.values.elements += values.elements;
+	entry.values.bytes += values.bytes;
+	entry.values.nanos += values.nanos;
+	entry.cache_hits += cache_hits;
+	entry.cache_misses += cache_misses;
+}
+
+void TextplotProfileState::QueryBegin(ClientContext &context) {
+	lock_guard<mutex> guard(lock);
+	current.clear();
+	current_index.clear();
+}
+
+void TextplotProfileState::QueryEnd(ClientContext &context) {
+	lock_guard<mutex> guard(lock);
+	// Queries without profiled tp_* expressions, tp_profile() itself among them, keep the previous profile
+	if (!current.empty()) {
+		last = std::move(current);
+	}
+	current.clear();
+	current_index.clear();
+}
+
+vector<TextplotProfileState::Entry> TextplotProfileState::LastQuery() {
+	lock_guard<mutex> guard(lock);
+	return last;
+}
+
+struct TextplotProfileGlobalState : public GlobalTableFunctionState {
+	vector<TextplotProfileState::Entry> entries;
+	idx_t offset = 0;
+};
+
+static unique_ptr<FunctionData> TextplotProfileBind(ClientContext &context, TableFunctionBindInput &input,
+                                                    vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"expression", "alias", "function"};
+	return_types = {LogicalType::VARCHAR, LogicalType::VARCHAR, LogicalType::VARCHAR};
+	for (const auto &name : {"rows", "elements", "output_bytes", "time_ns", "cache_hits", "cache_misses"}) {
+		names.emplace_back(name);
+		return_types.push_back(LogicalType::UBIGINT);
+	}
+	return make_uniq<TableFunctionData>();
+}
+
+static unique_ptr<GlobalTableFunctionState> TextplotProfileInit(ClientContext &context,
+                                                                TableFunctionInitInput &input) {
+	auto state = make_uniq<TextplotProfileGlobalState>();
+	state->entries = TextplotProfileState::Get(context).LastQuery();
+	return std::move(state);
+}
+
+static void TextplotProfileScan(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &state = data_p.global_state->Cast<TextplotProfileGlobalState>();
+	idx_t count = 0;
+	for (; state.offset < state.entries.size() && count < STANDARD_VECTOR_SIZE; state.offset++, count++) {
+		const auto &entry = state.entries[state.offset];
+		output.SetValue(0, count, Value(entry.expression));
+		output.SetValue(1, count, entry.alias.empty() ? Value(LogicalType::VARCHAR) : Value(entry.alias));
+		output.SetValue(2, count, Value(TextplotStatsFunctionName(entry.function)));
+		output.SetValue(3, count, Value::UBIGINT(entry.values.rows));
+		output.SetValue(4, count, Value::UBIGINT(entry.values.elements));
+		output.SetValue(5, count, Value::UBIGINT(entry.values.bytes));
+		output.SetValue(6, count, Value::UBIGINT(entry.values.nanos));
+		output.SetValue(7, count, Value::UBIGINT(entry.cache_hits));
+		output.SetValue(8, count, Value::UBIGINT(entry.cache_misses));
+	}
+	output.SetCardinality(count);
+}
+
+TableFunction TextplotProfileTableFunction() {
+	return TableFunction("tp_profile", {}, TextplotProfileScan, TextplotProfileBind, TextplotProfileInit);
+}
+
+} // namespace duckdb
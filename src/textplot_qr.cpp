@@ -1,21 +1,73 @@
 #include "textplot_bar.hpp"
+#include "textplot_qr_cache.hpp"
+#include "textplot_render.hpp"
+#include "textplot_stats.hpp"
 #include "duckdb/common/string_util.hpp"
 #include "duckdb/function/scalar_function.hpp"
 #include "duckdb/common/vector_operations/unary_executor.hpp"
 #include "duckdb/planner/expression/bound_function_expression.hpp"
 #include "duckdb/execution/expression_executor.hpp"
+#include "duckdb/execution/expression_executor_state.hpp"
 #include <algorithm>
+#include <cstring>
 #include "qrcodegen.hpp"
 
 namespace duckdb {
 
+// Modules drawn per glyph
+enum class TextplotQRStyle : uint8_t {
+	FULL,    // One module per glyph, drawn with 'on' and 'off'
+	HALF,    // Two vertically stacked modules per half block
+	QUADRANT // 2x2 modules per quadrant block
+};
+
+// Indexed by top | bottom << 1
+static const string QR_HALF_GLYPHS[] = {" ", "▀", "▄", "█"};
+// Indexed by upper left | upper right << 1 | lower left << 2 | lower right << 3
+static const string QR_QUADRANT_GLYPHS[] = {" ", "▘", "▝", "▀", "▖", "▌", "▞", "▛",
+                                            "▗", "▚", "▐", "▜", "▄", "▙", "▟", "█"};
+
+// How payloads are encoded, validated and resolved at bind time
+struct TextplotQREncoding {
+	qrcodegen::QrCode::Ecc ecc = qrcodegen::QrCode::Ecc::LOW;
+	// 0 to 7, -1 evaluates all eight masks and keeps the one with the lowest penalty
+	int mask = -1;
+	// The smallest version between these that fits the payload is used
+	int min_version = qrcodegen::QrCode::MIN_VERSION;
+	int max_version = qrcodegen::QrCode::MAX_VERSION;
+	// Raise 'ecc' as far as the chosen version allows
+	bool boost_ecc = true;
+	// BLOBs are encoded as bytes, VARCHARs in the most compact mode for their characters
+	bool binary = false;
+
+	bool operator==(const TextplotQREncoding &other) const {
+		return ecc == other.ecc && mask == other.mask && min_version == other.min_version &&
+		       max_version == other.max_version && boost_ecc == other.boost_ecc && binary == other.binary;
+	}
+
+	string CacheKey() const {
+		return StringUtil::Format("%d,%d,%d,%d,%d,%d", static_cast<int>(ecc), mask, min_version, max_version,
+		                          boost_ecc, binary);
+	}
+};
+
 struct TextplotQRBindData : public FunctionData {
-	string ecc = "low";
+	TextplotQREncoding encoding;
 	string on = "";
 	string off = "";
+	TextplotQRStyle style = TextplotQRStyle::FULL;
+	// tp_qr_matrix, the result is the bit-packed matrix instead of text
+	bool matrix = false;
+	// The options as part of the key of a cached rendering, and their hash
+	string cache_key;
+	hash_t cache_hash;
 
-	TextplotQRBindData(string ecc_p, string on_p, string off_p)
-	    : ecc(std::move(ecc_p)), on(std::move(on_p)), off(std::move(off_p)) {
+	TextplotQRBindData(TextplotQREncoding encoding_p, string on_p, string off_p, TextplotQRStyle style_p,
+	                   bool matrix_p)
+	    : encoding(encoding_p), on(std::move(on_p)), off(std::move(off_p)), style(style_p), matrix(matrix_p) {
+		cache_key = encoding.CacheKey() + '\0' + on + '\0' + off + '\0' + std::to_string(static_cast<int>(style)) +
+		            (matrix ? string("\0matrix", 7) : string());
+		cache_hash = Hash(cache_key.data(), cache_key.size());
 	}
 
 	unique_ptr<FunctionData> Copy() const override;
@@ -23,107 +75,352 @@ struct TextplotQRBindData : public FunctionData {
 };
 
 unique_ptr<FunctionData> TextplotQRBindData::Copy() const {
-	return make_uniq<TextplotQRBindData>(ecc, on, off);
+	return make_uniq<TextplotQRBindData>(encoding, on, off, style, matrix);
 }
 
 bool TextplotQRBindData::Equals(const FunctionData &other_p) const {
 	const auto &other = other_p.Cast<TextplotQRBindData>();
-	return ecc == other.ecc && on == other.on && off == other.off;
+	return encoding == other.encoding && on == other.on && off == other.off && style == other.style &&
+	       matrix == other.matrix;
 }
 
-unique_ptr<FunctionData> TextplotQRBind(ClientContext &context, ScalarFunction &bound_function,
-                                        vector<unique_ptr<Expression>> &arguments) {
+// Per thread buffers reused from row to row
+struct TextplotQRLocalState : public FunctionLocalState {
+	// A VARCHAR as a NUL terminated string, or the bytes of a BLOB, for the encoder
+	string text;
+	std::vector<std::uint8_t> bytes;
+	TextplotRender output;
+	// Renderings shared by the database
+	shared_ptr<TextplotQRCache> cache;
+};
 
-	if (arguments.empty()) {
-		throw BinderException("tp_qr takes at least one argument");
+unique_ptr<FunctionLocalState> TextplotQRInitLocalState(ExpressionState &state, const BoundFunctionExpression &expr,
+                                                        FunctionData *bind_data) {
+	auto local_state = make_uniq<TextplotQRLocalState>();
+	local_state->cache = TextplotQRCache::Get(state.GetContext());
+	return std::move(local_state);
+}
+
+static int BindQRInteger(ClientContext &context, const string &function_name, const string &alias, Expression &arg,
+                         int min, int max) {
+	if (!arg.return_type.IsIntegral()) {
+		throw BinderException(StringUtil::Format("%s: '%s' argument must be an integer", function_name, alias));
+	}
+	const auto value = ExpressionExecutor::EvaluateScalar(context, arg);
+	const auto result = value.IsNull() ? min - 1 : value.CastAs(context, LogicalType::BIGINT).GetValue<int64_t>();
+	if (result < min || result > max) {
+		throw BinderException(
+		    StringUtil::Format("%s: '%s' argument must be between %d and %d", function_name, alias, min, max));
+	}
+	return static_cast<int>(result);
+}
+
+// Binds the encoding options ecc, mask, min_version, max_version and boost_ecc. Returns false if 'alias' is none
+// of them.
+static bool BindQREncodingOption(ClientContext &context, const string &function_name, const string &alias,
+                                 Expression &arg, TextplotQREncoding &encoding) {
+	if (alias == "ecc") {
+		if (arg.return_type.id() != LogicalTypeId::VARCHAR) {
+			throw BinderException(StringUtil::Format("%s: 'ecc' argument must be a VARCHAR", function_name));
+		}
+		const auto ecc = StringValue::Get(ExpressionExecutor::EvaluateScalar(context, arg));
+		if (ecc == "low") {
+			encoding.ecc = qrcodegen::QrCode::Ecc::LOW;
+		} else if (ecc == "medium") {
+			encoding.ecc = qrcodegen::QrCode::Ecc::MEDIUM;
+		} else if (ecc == "quartile") {
+			encoding.ecc = qrcodegen::QrCode::Ecc::QUARTILE;
+		} else if (ecc == "high") {
+			encoding.ecc = qrcodegen::QrCode::Ecc::HIGH;
+		} else {
+			throw BinderException(StringUtil::Format(
+			    "%s: 'ecc' argument must be one of 'low', 'medium', 'quartile', 'high'", function_name));
+		}
+	} else if (alias == "mask") {
+		encoding.mask = BindQRInteger(context, function_name, alias, arg, 0, 7);
+	} else if (alias == "min_version") {
+		encoding.min_version = BindQRInteger(context, function_name, alias, arg, qrcodegen::QrCode::MIN_VERSION,
+		                                     qrcodegen::QrCode::MAX_VERSION);
+	} else if (alias == "max_version") {
+		encoding.max_version = BindQRInteger(context, function_name, alias, arg, qrcodegen::QrCode::MIN_VERSION,
+		                                     qrcodegen::QrCode::MAX_VERSION);
+	} else if (alias == "boost_ecc") {
+		if (arg.return_type.id() != LogicalTypeId::BOOLEAN) {
+			throw BinderException(StringUtil::Format("%s: 'boost_ecc' argument must be a BOOLEAN", function_name));
+		}
+		const auto value = ExpressionExecutor::EvaluateScalar(context, arg);
+		encoding.boost_ecc = !value.IsNull() && BooleanValue::Get(value);
+	} else {
+		return false;
+	}
+	if (encoding.min_version > encoding.max_version) {
+		throw BinderException(
+		    StringUtil::Format("%s: 'min_version' must not be larger than 'max_version'", function_name));
 	}
+	return true;
+}
 
-	if (!(arguments[0]->return_type == LogicalType::VARCHAR || arguments[0]->return_type == LogicalType::BLOB)) {
-		throw InvalidTypeException("tp_qr first argument must a VARCHAR or BLOB");
+// Encodes a payload, VARCHARs through the segment modes picked by qrcodegen, BLOBs as one byte segment.
+// qrcodegen reads text as a C string, so a VARCHAR with a NUL byte is encoded as bytes as well, which is the mode
+// it would pick for such text anyway.
+static qrcodegen::QrCode EncodeQR(const string &function_name, const TextplotQREncoding &encoding, string_t value,
+                                  TextplotQRLocalState &local_state) {
+	std::vector<qrcodegen::QrSegment> segments;
+	if (encoding.binary || std::memchr(value.GetData(), '\0', value.GetSize())) {
+		const auto data = reinterpret_cast<const std::uint8_t *>(value.GetData());
+		local_state.bytes.assign(data, data + value.GetSize());
+		segments.push_back(qrcodegen::QrSegment::makeBytes(local_state.bytes));
+	} else {
+		local_state.text.assign(value.GetData(), value.GetSize());
+		segments = qrcodegen::QrSegment::makeSegments(local_state.text.c_str());
+	}
+	try {
+		return qrcodegen::QrCode::encodeSegments(segments, encoding.ecc, encoding.min_version, encoding.max_version,
+		                                         encoding.mask, encoding.boost_ecc);
+	} catch (qrcodegen::data_too_long &) {
+		throw InvalidInputException("%s: a value of %llu bytes does not fit into a QR code of version %d or lower",
+		                            function_name, value.GetSize(), encoding.max_version);
 	}
+}
 
-	// Optional arguments
-	string ecc = "low";
+// Binds the optional arguments of the tp_qr functions starting at 'first_option'. The encoding options are taken
+// if 'encode' is set, on, off and style if 'render' is set.
+static unique_ptr<TextplotQRBindData> BindQROptions(ClientContext &context, const string &function_name,
+                                                    vector<unique_ptr<Expression>> &arguments, idx_t first_option,
+                                                    bool encode, bool render, TextplotQREncoding encoding) {
 	string on = "";
 	string off = "";
+	string style = "full";
 
-	for (idx_t i = 1; i < arguments.size(); i++) {
+	for (idx_t i = first_option; i < arguments.size(); i++) {
 		const auto &arg = arguments[i];
 		if (arg->HasParameter()) {
 			throw ParameterNotResolvedException();
 		}
 		if (!arg->IsFoldable()) {
-			throw BinderException("tp_qr: arguments must be constant");
+			throw BinderException(StringUtil::Format("%s: arguments must be constant", function_name));
 		}
 		const auto &alias = arg->GetAlias();
-		if (alias == "ecc") {
-			if (arg->return_type.id() != LogicalTypeId::VARCHAR) {
-				throw BinderException("tp_qr: 'ecc' argument must be a VARCHAR");
-			}
-			ecc = StringValue::Get(ExpressionExecutor::EvaluateScalar(context, *arg));
-		} else if (alias == "on") {
-			if (arg->return_type.id() != LogicalTypeId::VARCHAR) {
-				throw BinderException("tp_qr: 'on' argument must be a VARCHAR");
-			}
-			on = StringValue::Get(ExpressionExecutor::EvaluateScalar(context, *arg));
-		} else if (alias == "off") {
+		if (encode && BindQREncodingOption(context, function_name, alias, *arg, encoding)) {
+			continue;
+		}
+		if (render && (alias == "on" || alias == "off" || alias == "style")) {
 			if (arg->return_type.id() != LogicalTypeId::VARCHAR) {
-				throw BinderException("tp_qr: 'off' argument must be a VARCHAR");
+				throw BinderException(
+				    StringUtil::Format("%s: '%s' argument must be a VARCHAR", function_name, alias));
 			}
-			off = StringValue::Get(ExpressionExecutor::EvaluateScalar(context, *arg));
+			const auto value = StringValue::Get(ExpressionExecutor::EvaluateScalar(context, *arg));
+			(alias == "on" ? on : alias == "off" ? off : style) = value;
 		} else {
-			throw BinderException(StringUtil::Format("tp_qr: Unknown argument '%s'", alias));
+			throw BinderException(StringUtil::Format("%s: Unknown argument '%s'", function_name, alias));
 		}
 	}
 
-	// Validate ECC at bind time
-	if (ecc != "low" && ecc != "medium" && ecc != "quartile" && ecc != "high") {
-		throw BinderException("tp_qr: 'ecc' argument must be one of 'low', 'medium', 'quartile', 'high'");
+	TextplotQRStyle style_type;
+	if (style == "full") {
+		style_type = TextplotQRStyle::FULL;
+	} else if (style == "half") {
+		style_type = TextplotQRStyle::HALF;
+	} else if (style == "quadrant") {
+		style_type = TextplotQRStyle::QUADRANT;
+	} else {
+		throw BinderException(
+		    StringUtil::Format("%s: 'style' argument must be one of 'full', 'half', 'quadrant'", function_name));
+	}
+	if (style_type != TextplotQRStyle::FULL && (!on.empty() || !off.empty())) {
+		throw BinderException(StringUtil::Format("%s: 'on' and 'off' are only supported with style 'full', the "
+		                                         "block styles draw dark modules as filled blocks",
+		                                         function_name));
 	}
 
-	if (off.empty()) {
+	if (render && off.empty()) {
 		off = "⬜";
 	}
 
-	if (on.empty()) {
+	if (render && on.empty()) {
 		on = "⬛";
 	}
 
-	return make_uniq<TextplotQRBindData>(ecc, on, off);
+	return make_uniq<TextplotQRBindData>(encoding, on, off, style_type, !render);
 }
 
-void TextplotQR(DataChunk &args, ExpressionState &state, Vector &result) {
+static TextplotQREncoding BindQRPayload(const string &function_name, vector<unique_ptr<Expression>> &arguments) {
+	if (arguments.empty()) {
+		throw BinderException(StringUtil::Format("%s takes at least one argument", function_name));
+	}
+	const auto &type = arguments[0]->return_type;
+	if (!(type == LogicalType::VARCHAR || type == LogicalType::BLOB)) {
+		throw InvalidTypeException(StringUtil::Format("%s first argument must a VARCHAR or BLOB", function_name));
+	}
+	TextplotQREncoding encoding;
+	encoding.binary = type == LogicalType::BLOB;
+	return encoding;
+}
+
+unique_ptr<FunctionData> TextplotQRBind(ClientContext &context, ScalarFunction &bound_function,
+                                        vector<unique_ptr<Expression>> &arguments) {
+	const auto encoding = BindQRPayload("tp_qr", arguments);
+	return BindQROptions(context, "tp_qr", arguments, 1, true, true, encoding);
+}
+
+unique_ptr<FunctionData> TextplotQRMatrixBind(ClientContext &context, ScalarFunction &bound_function,
+                                              vector<unique_ptr<Expression>> &arguments) {
+	const auto encoding = BindQRPayload("tp_qr_matrix", arguments);
+	return BindQROptions(context, "tp_qr_matrix", arguments, 1, true, false, encoding);
+}
+
+unique_ptr<FunctionData> TextplotQRRenderBind(ClientContext &context, ScalarFunction &bound_function,
+                                              vector<unique_ptr<Expression>> &arguments) {
+	if (arguments.empty()) {
+		throw BinderException("tp_qr_render takes at least one argument");
+	}
+	if (arguments[0]->return_type != LogicalType::BLOB) {
+		throw InvalidTypeException("tp_qr_render first argument must be a BLOB returned by tp_qr_matrix");
+	}
+	return BindQROptions(context, "tp_qr_render", arguments, 1, false, true, TextplotQREncoding());
+}
+
+// Draws the size x size modules, one text line per row of glyphs. 'get_module' is true for a dark module and
+// is also asked for the modules just past the last row and column, which are light.
+template <class GET_MODULE>
+static void RenderModules(const TextplotQRBindData &bind_data, int size, GET_MODULE get_module,
+                          TextplotRender &output) {
+	switch (bind_data.style) {
+	case TextplotQRStyle::FULL:
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				output.Append(get_module(x, y) ? bind_data.on : bind_data.off);
+			}
+			output.Append("\n", 1);
+		}
+		break;
+	case TextplotQRStyle::HALF:
+		for (int y = 0; y < size; y += 2) {
+			for (int x = 0; x < size; x++) {
+				output.Append(QR_HALF_GLYPHS[get_module(x, y) | get_module(x, y + 1) << 1]);
+			}
+			output.Append("\n", 1);
+		}
+		break;
+	case TextplotQRStyle::QUADRANT:
+		for (int y = 0; y < size; y += 2) {
+			for (int x = 0; x < size; x += 2) {
+				const auto index = get_module(x, y) | get_module(x + 1, y) << 1 | get_module(x, y + 1) << 2 |
+				                   get_module(x + 1, y + 1) << 3;
+				output.Append(QR_QUADRANT_GLYPHS[index]);
+			}
+			output.Append("\n", 1);
+		}
+		break;
+	}
+}
+
+// Encodes every payload, or takes it from the cache, and writes the result with 'write'
+template <class WRITE>
+static void ExecuteQR(const string &function_name, TextplotStatsFunction function, DataChunk &args,
+                      ExpressionState &state, Vector &result, WRITE write) {
 	auto &value_vector = args.data[0];
 	const auto &func_expr = state.expr.Cast<BoundFunctionExpression>();
 	const auto &bind_data = func_expr.bind_info->Cast<TextplotQRBindData>();
+	auto &local_state = ExecuteFunctionState::GetFunctionState(state)->Cast<TextplotQRLocalState>();
+
+	TextplotStatsScope stats(state, function);
+	idx_t elements = 0;
+
+	auto &cache = *local_state.cache;
+	const bool use_cache = cache.Enabled();
 
 	UnaryExecutor::Execute<string_t, string_t>(value_vector, result, args.size(), [&](string_t value) {
-		// std::vector<qrcodegen::QrSegment> segs = qrcodegen::QrSegment::makeSegments(value.GetData());
-
-		// auto qr = qrcodegen::QrCode::encodeSegments(segs, qrcodegen::QrCode::Ecc::LOW, bind_data.min_version,
-		//                                             bind_data.max_version, -1, bind_data.boost_ecc);
-
-		// ECC is already validated at bind time
-		qrcodegen::QrCode::Ecc ecc_level = qrcodegen::QrCode::Ecc::LOW;
-		if (bind_data.ecc == "medium") {
-			ecc_level = qrcodegen::QrCode::Ecc::MEDIUM;
-		} else if (bind_data.ecc == "quartile") {
-			ecc_level = qrcodegen::QrCode::Ecc::QUARTILE;
-		} else if (bind_data.ecc == "high") {
-			ecc_level = qrcodegen::QrCode::Ecc::HIGH;
+		elements += value.GetSize();
+		hash_t hash = 0;
+		if (use_cache) {
+			// A repeated payload costs a hash lookup instead of an encode
+			hash = CombineHash(Hash(value.GetData(), value.GetSize()), bind_data.cache_hash);
+			auto cached = cache.Lookup(hash, value, bind_data.cache_key);
+			if (cached) {
+				stats.CacheHit();
+				return StringVector::AddStringOrBlob(result, *cached);
+			}
+			stats.CacheMiss();
 		}
 
-		auto qr = qrcodegen::QrCode::encodeText(value.GetString().c_str(), ecc_level);
+		const auto qr = EncodeQR(function_name, bind_data.encoding, value, local_state);
+		const auto written = write(bind_data, qr, local_state);
+		if (use_cache) {
+			cache.Insert(hash, value, bind_data.cache_key,
+			             make_shared_ptr<const string>(written.GetData(), written.GetSize()));
+		}
+		return written;
+	});
+	stats.Record(result, args.size(), elements);
+}
 
-		string result_str;
-		for (int y = 0; y < qr.getSize(); y++) {
-			for (int x = 0; x < qr.getSize(); x++) {
-				result_str += qr.getModule(x, y) ? bind_data.on : bind_data.off;
-			}
-			result_str += "\n";
+void TextplotQR(DataChunk &args, ExpressionState &state, Vector &result) {
+	ExecuteQR("tp_qr", TextplotStatsFunction::QR, args, state, result,
+	          [&](const TextplotQRBindData &bind_data, const qrcodegen::QrCode &qr, TextplotQRLocalState &local_state) {
+		          auto &output = local_state.output;
+		          output.Clear();
+		          RenderModules(bind_data, qr.getSize(), [&](int x, int y) { return qr.getModule(x, y); }, output);
+		          return output.Write(result);
+	          });
+}
+
+// The matrix BLOB is one byte with the size of the code followed by its size x size modules in row-major order,
+// eight per byte starting at the least significant bit, 1 for a dark module
+static idx_t QRMatrixBytes(idx_t size) {
+	return 1 + (size * size + 7) / 8;
+}
+
+void TextplotQRMatrix(DataChunk &args, ExpressionState &state, Vector &result) {
+	ExecuteQR("tp_qr_matrix", TextplotStatsFunction::QR_MATRIX, args, state, result,
+	          [&](const TextplotQRBindData &bind_data, const qrcodegen::QrCode &qr, TextplotQRLocalState &local_state) {
+		          const auto size = qr.getSize();
+		          auto target = StringVector::EmptyString(result, QRMatrixBytes(size));
+		          auto data = reinterpret_cast<uint8_t *>(target.GetDataWriteable());
+		          memset(data, 0, target.GetSize());
+		          data[0] = static_cast<uint8_t>(size);
+		          idx_t bit = 0;
+		          for (int y = 0; y < size; y++) {
+			          for (int x = 0; x < size; x++, bit++) {
+				          data[1 + bit / 8] |= static_cast<uint8_t>(qr.getModule(x, y)) << (bit % 8);
+			          }
+		          }
+		          target.Finalize();
+		          return target;
+	          });
+}
+
+void TextplotQRRender(DataChunk &args, ExpressionState &state, Vector &result) {
+	const auto &func_expr = state.expr.Cast<BoundFunctionExpression>();
+	const auto &bind_data = func_expr.bind_info->Cast<TextplotQRBindData>();
+	auto &local_state = ExecuteFunctionState::GetFunctionState(state)->Cast<TextplotQRLocalState>();
+	TextplotStatsScope stats(state, TextplotStatsFunction::QR_RENDER);
+	idx_t elements = 0;
+
+	UnaryExecutor::Execute<string_t, string_t>(args.data[0], result, args.size(), [&](string_t matrix) {
+		const auto data = reinterpret_cast<const uint8_t *>(matrix.GetData());
+		const int size = matrix.GetSize() > 0 ? data[0] : 0;
+		// Sizes of versions 1 to 40 are 21 to 177 in steps of 4
+		if (size < 21 || size > 177 || (size - 21) % 4 != 0 || matrix.GetSize() != QRMatrixBytes(size)) {
+			throw InvalidInputException("tp_qr_render: the BLOB is not a QR matrix returned by tp_qr_matrix");
 		}
-		return StringVector::AddString(result, result_str);
+		const auto modules = data + 1;
+		elements += size * size;
+		auto &output = local_state.output;
+		output.Clear();
+		RenderModules(
+		    bind_data, size,
+		    [&](int x, int y) {
+			    if (x >= size || y >= size) {
+				    return false;
+			    }
+			    const auto bit = static_cast<idx_t>(y) * size + x;
+			    return ((modules[bit / 8] >> (bit % 8)) & 1) != 0;
+		    },
+		    output);
+		return output.Write(result);
 	});
+	stats.Record(result, args.size(), elements);
 }
 
 } // namespace duckdb
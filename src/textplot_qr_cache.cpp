@@ -0,0 +1,93 @@
+#include "textplot_qr_cache.hpp"
+#include "duckdb/main/client_context.hpp"
+
+namespace duckdb {
+
+shared_ptr<TextplotQRCache> TextplotQRCache::Get(ClientContext &context) {
+	idx_t capacity = TEXTPLOT_QR_DEFAULT_CACHE_SIZE;
+	Value setting;
+	if (context.TryGetCurrentSetting("tp_qr_cache_size", setting) && !setting.IsNull()) {
+		capacity = UBigIntValue::Get(setting);
+	}
+	return ObjectCache::GetObjectCache(context).GetOrCreate<TextplotQRCache>(ObjectType(), capacity);
+}
+
+shared_ptr<const string> TextplotQRCache::Lookup(hash_t hash, const string_t &payload, const string &options) {
+	lock_guard<mutex> guard(lock);
+	auto entry = index.find(hash);
+	if (entry == index.end() || entry->second->options != options ||
+	    entry->second->payload.size() != payload.GetSize() ||
+	    memcmp(entry->second->payload.data(), payload.GetData(), payload.GetSize()) != 0) {
+		misses++;
+		return nullptr;
+	}
+	hits++;
+	entries.splice(entries.begin(), entries, entry->second);
+	return entry->second->rendered;
+}
+
+void TextplotQRCache::Insert(hash_t hash, const string_t &payload, const string &options,
+                             shared_ptr<const string> rendered) {
+	lock_guard<mutex> guard(lock);
+	if (capacity == 0) {
+		return;
+	}
+	auto existing = index.find(hash);
+	if (existing != index.end()) {
+		// Another payload with the same hash, or the same one inserted by another thread
+		entries.erase(existing->second);
+		index.erase(existing);
+	}
+	Evict(capacity - 1);
+	entries.push_front(Entry {hash, string(payload.GetData(), payload.GetSize()), options, std::move(rendered)});
+	index[hash] = entries.begin();
+}
+
+void TextplotQRCache::Evict(idx_t target) {
+	while (entries.size() > target) {
+		index.erase(entries.back().hash);
+		entries.pop_back();
+	}
+}
+
+void TextplotQRCache::SetCapacity(idx_t capacity_p) {
+	lock_guard<mutex> guard(lock);
+	capacity = capacity_p;
+	Evict(capacity);
+}
+
+TextplotQRCacheStats TextplotQRCache::GetStats() const {
+	lock_guard<mutex> guard(lock);
+	return TextplotQRCacheStats {hits, misses, entries.size(), capacity.load()};
+}
+
+void TextplotQRCacheSizeSetting(ClientContext &context, SetScope scope, Value &parameter) {
+	if (scope == SetScope::SESSION || scope == SetScope::LOCAL) {
+		throw InvalidInputException("tp_qr_cache_size: the cache is shared by all connections of the database, "
+		                            "the setting can only be set globally");
+	}
+	const auto capacity = parameter.IsNull() ? TEXTPLOT_QR_DEFAULT_CACHE_SIZE : UBigIntValue::Get(parameter);
+	TextplotQRCache::Get(context)->SetCapacity(capacity);
+}
+
+LogicalType TextplotQRCacheStatsType() {
+	child_list_t<LogicalType> fields;
+	fields.emplace_back("hits", LogicalType::UBIGINT);
+	fields.emplace_back("misses", LogicalType::UBIGINT);
+	fields.emplace_back("entries", LogicalType::UBIGINT);
+	fields.emplace_back("capacity", LogicalType::UBIGINT);
+	return LogicalType::STRUCT(std::move(fields));
+}
+
+void TextplotQRCacheStatsFunction(DataChunk &args, ExpressionState &state, Vector &result) {
+	const auto stats = TextplotQRCache::Get(state.GetContext())->GetStats();
+	const idx_t values[] = {stats.hits, stats.misses, stats.entries, stats.capacity};
+	auto &fields = StructVector::GetEntries(result);
+	for (idx_t i = 0; i < fields.size(); i++) {
+		fields[i]->SetVectorType(VectorType::CONSTANT_VECTOR);
+		ConstantVector::GetData<uint64_t>(*fields[i])[0] = values[i];
+	}
+	result.SetVectorType(VectorType::CONSTANT_VECTOR);
+}
+
+} // namespace duckdb
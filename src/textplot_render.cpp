@@ -0,0 +1,42 @@
+#include "textplot_render.hpp"
+#include <cstring>
+
+namespace duckdb {
+
+void TextplotRender::WriteTo(char *target) const {
+	for (const auto &run : runs) {
+		if (run.count == 1 || run.length > 1) {
+			memcpy(target, run.data, run.length);
+		}
+		if (run.count > 1) {
+			if (run.length == 1) {
+				memset(target, run.data[0], run.count);
+			} else {
+				// Run-length fill, every copy doubles the bytes written so far
+				const auto total = run.length * run.count;
+				idx_t written = run.length;
+				while (written < total) {
+					const auto chunk = MinValue(written, total - written);
+					memcpy(target + written, target, chunk);
+					written += chunk;
+				}
+			}
+		}
+		target += run.length * run.count;
+	}
+}
+
+string_t TextplotRender::Write(Vector &result) const {
+	auto target = StringVector::EmptyString(result, size);
+	WriteTo(target.GetDataWriteable());
+	target.Finalize();
+	return target;
+}
+
+string TextplotRender::ToString() const {
+	string result(size, '\0');
+	WriteTo(&result[0]);
+	return result;
+}
+
+} // namespace duckdb
@@ -0,0 +1,53 @@
+#include "textplot_scale.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/execution/expression_executor.hpp"
+#include "duckdb/planner/expression/bound_cast_expression.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace duckdb {
+
+TextplotScaleBound TextplotBindScaleBound(ClientContext &context, const string &function_name, const string &alias,
+                                          vector<unique_ptr<Expression>> &arguments, idx_t index) {
+	auto &arg = arguments[index];
+	if (!arg->return_type.IsNumeric()) {
+		throw BinderException(StringUtil::Format("%s: '%s' argument must be numeric", function_name, alias));
+	}
+
+	TextplotScaleBound bound;
+	bound.is_set = true;
+	if (arg->IsFoldable()) {
+		const auto eval_result = ExpressionExecutor::EvaluateScalar(context, *arg);
+		if (eval_result.IsNull()) {
+			throw BinderException(StringUtil::Format("%s: '%s' argument must not be NULL", function_name, alias));
+		}
+		bound.value = eval_result.CastAs(context, LogicalType::DOUBLE).GetValue<double>();
+	} else {
+		// The cast replaces the argument, it keeps the alias so that 'min' and 'max' are still found by name
+		auto cast = BoundCastExpression::AddCastToType(context, std::move(arguments[index]), LogicalType::DOUBLE);
+		cast->SetAlias(alias);
+		arguments[index] = std::move(cast);
+		bound.column = index;
+	}
+	return bound;
+}
+
+void TextplotClampOpenScale(bool has_min, bool has_max, double &min, double &max) {
+	if (has_min == has_max || min < max) {
+		return;
+	}
+	if (has_min) {
+		max = min + std::max(std::abs(min), 1.0);
+	} else {
+		min = max - std::max(std::abs(max), 1.0);
+	}
+}
+
+TextplotScaleReader::TextplotScaleReader(const TextplotScaleBound &bound_p, DataChunk &args) : bound(bound_p) {
+	if (bound.column.IsValid()) {
+		args.data[bound.column.GetIndex()].ToUnifiedFormat(args.size(), format);
+		data = UnifiedVectorFormat::GetData<double>(format);
+	}
+}
+
+} // namespace duckdb
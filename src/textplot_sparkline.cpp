@@ -1,22 +1,19 @@
 #include "textplot_sparkline.hpp"
+#include "textplot_kernels.hpp"
+#include "textplot_list.hpp"
+#include "textplot_render.hpp"
+#include "textplot_scale.hpp"
+#include "textplot_stats.hpp"
 #include "duckdb/common/string_util.hpp"
 #include "duckdb/function/scalar_function.hpp"
 #include "duckdb/common/vector_operations/unary_executor.hpp"
 #include "duckdb/planner/expression/bound_function_expression.hpp"
 #include "duckdb/execution/expression_executor.hpp"
 #include <algorithm>
+#include <limits>
 
 namespace duckdb {
 
-/**
- * Sparkline generation modes
- */
-enum class SparklineMode {
-	ABSOLUTE, // Show absolute values (height-based)
-	DELTA,    // Show change direction (up/down/same)
-	TREND     // Show trend direction with magnitude
-};
-
 /**
  * Enhanced sparkline themes with directional support
  */
@@ -31,7 +28,7 @@ public:
 	// Trend themes (up/down with magnitude)
 	static const std::unordered_map<std::string, std::vector<std::string>> trendThemes;
 
-	static std::vector<std::string> getTheme(const std::string &themeName, SparklineMode mode) {
+	static const std::vector<std::string> &getTheme(const std::string &themeName, SparklineMode mode) {
 		const auto *themeMap = &absoluteThemes;
 
 		switch (mode) {
@@ -53,8 +50,7 @@ public:
 		}
 
 		// Fallback
-		auto fallback = absoluteThemes.find("utf8_blocks");
-		return (fallback != absoluteThemes.end()) ? fallback->second : std::vector<std::string> {" ", "█"};
+		return absoluteThemes.at("utf8_blocks");
 	}
 
 	static vector<std::string> getAvailableThemes(SparklineMode mode) {
@@ -102,235 +98,259 @@ const std::unordered_map<std::string, std::vector<std::string>> EnhancedSparklin
     {"slopes", {"\\\\", "\\", "_", "/", "//"}}, {"intensity", {"--", "-", "=", "+", "++"}},
     {"faces", {"😭", "😞", "😐", "😊", "🤩"}},  {"chart", {"📉", "📊", "➡️", "📊", "📈"}}};
 
+static void appendGlyphs(const std::vector<std::string> &characters, const int32_t *levels, idx_t width,
+                         TextplotRender &result) {
+	for (idx_t i = 0; i < width; i++) {
+		result.Append(characters[levels[i]]);
+	}
+}
+
 /**
- * Generate sparkline showing absolute values (original behavior)
+ * Draws bucket means scaled to [min_val, max_val] (absolute mode)
  */
-std::string generateAbsoluteSparkline(const double *data, int size, int width,
-                                      const std::vector<std::string> &characters) {
-	if (size == 0 || width == 0 || characters.empty())
-		return "";
-
-	double min_val = *std::min_element(data, data + size);
-	double max_val = *std::max_element(data, data + size);
+static void appendAbsoluteLevels(const double *means, idx_t width, const std::vector<std::string> &characters,
+                                 double min_val, double max_val, vector<int32_t> &levels, TextplotRender &result) {
+	if (min_val > max_val) {
+		throw InvalidInputException("tp_sparkline: 'min' must be less than 'max'");
+	}
 
 	if (max_val == min_val) {
-		int mid_idx = characters.size() / 2;
-		std::string result;
-		for (int i = 0; i < width; i++) {
-			result += characters[mid_idx];
-		}
-		return result;
+		const auto &mid_char = characters[characters.size() / 2];
+		result.Append(mid_char, width);
+		return;
 	}
 
-	std::string result;
-	double data_per_char = static_cast<double>(size) / width;
-	int max_level = static_cast<int>(characters.size()) - 1;
-
-	for (int i = 0; i < width; i++) {
-		int start_idx = static_cast<int>(i * data_per_char);
-		int end_idx = static_cast<int>((i + 1) * data_per_char);
-		// Clamp indices to valid range
-		if (start_idx >= size)
-			start_idx = size - 1;
-		if (end_idx > size)
-			end_idx = size;
-		if (start_idx >= end_idx)
-			end_idx = start_idx + 1;
-		// Final safety check: ensure we don't exceed array bounds
-		if (end_idx > size)
-			end_idx = size;
-
-		double sum = 0.0;
-		for (int j = start_idx; j < end_idx; j++) {
-			sum += data[j];
-		}
-		double avg_val = sum / (end_idx - start_idx);
-
-		double normalized = (avg_val - min_val) / (max_val - min_val);
-		int level = static_cast<int>(std::round(normalized * max_level));
-		level = std::max(0, std::min(max_level, level));
+	levels.resize(width);
+	TextplotLevelKernel(means, width, min_val, max_val, static_cast<int32_t>(characters.size()) - 1, levels.data());
+	appendGlyphs(characters, levels.data(), width, result);
+}
 
-		result += characters[level];
+/**
+ * Generate sparkline showing absolute values (original behavior), scale_min/scale_max override
+ * the range of the data when given. The sparkline is appended to 'result'.
+ */
+static void generateAbsoluteSparkline(const double *data, idx_t size, idx_t width,
+                                      const std::vector<std::string> &characters, const double *scale_min,
+                                      const double *scale_max, TextplotListLocalState &scratch,
+                                      TextplotRender &result) {
+	if (size == 0 || width == 0 || characters.empty())
+		return;
+
+	// Bucket averages and the extent of the data in one pass
+	auto &means = scratch.work;
+	means.resize(width);
+	const auto extent = TextplotBucketMeanKernel(data, size, width, means.data());
+	if (extent.count == 0) {
+		// Only NaN, nothing to scale
+		return;
 	}
 
-	return result;
+	double min_val = scale_min ? *scale_min : extent.min;
+	double max_val = scale_max ? *scale_max : extent.max;
+	TextplotClampOpenScale(scale_min != nullptr, scale_max != nullptr, min_val, max_val);
+	appendAbsoluteLevels(means.data(), width, characters, min_val, max_val, scratch.levels, result);
 }
 
 /**
  * Generate sparkline showing directional change (delta mode)
  */
-std::string generateDeltaSparkline(const double *data, int size, int width,
-                                   const std::vector<std::string> &characters) {
+static void generateDeltaSparkline(const double *data, idx_t size, idx_t width,
+                                   const std::vector<std::string> &characters, TextplotListLocalState &scratch,
+                                   TextplotRender &result) {
 	if (size < 2 || width == 0 || characters.size() < 3)
-		return "";
-
-	std::string result;
-	double data_per_char = static_cast<double>(size - 1) / width; // -1 because we're looking at changes
-
-	for (int i = 0; i < width; i++) {
-		int idx = static_cast<int>(i * data_per_char);
-		if (idx >= size - 1)
-			idx = size - 2;
-
-		double current = data[idx];
-		double next = data[idx + 1];
-		double change = next - current;
-
-		// Determine direction: 0=down, 1=same, 2=up
-		int direction = 1; // default to same
-		if (change < -1e-10)
-			direction = 0; // down
-		else if (change > 1e-10)
-			direction = 2; // up
-
-		result += characters[direction];
+		return;
+
+	// Without a threshold no change is large, which leaves levels 1 (down), 2 (same) and 3 (up)
+	auto &levels = scratch.levels;
+	levels.resize(width);
+	TextplotChangeLevelKernel(data, size, width, std::numeric_limits<double>::infinity(), levels.data());
+	for (idx_t i = 0; i < width; i++) {
+		result.Append(characters[levels[i] - 1]);
 	}
-
-	return result;
 }
 
 /**
- * Generate sparkline showing trend with magnitude
+ * Threshold between small and large changes in trend mode, the median of the absolute changes that are
+ * not near zero. Series i spans data[bounds[i]] to data[bounds[i + 1]], changes are only taken within a
+ * series. 'magnitudes' is scratch space.
  */
-std::string generateTrendSparkline(const double *data, int size, int width,
-                                   const std::vector<std::string> &characters) {
-	if (size < 2 || width == 0 || characters.size() < 5)
-		return "";
-
-	// Calculate all changes to determine thresholds
-	std::vector<double> changes;
-	for (int i = 0; i < size - 1; i++) {
-		changes.push_back(data[i + 1] - data[i]);
-	}
-
-	// Find thresholds for small vs large changes
-	std::vector<double> abs_changes;
-	for (double change : changes) {
-		if (std::abs(change) > 1e-10) { // ignore near-zero changes
-			abs_changes.push_back(std::abs(change));
-		}
+static double trendThreshold(const double *data, const idx_t *bounds, idx_t series_count,
+                             std::vector<double> &magnitudes) {
+	idx_t changes = 0;
+	for (idx_t i = 0; i < series_count; i++) {
+		const auto size = bounds[i + 1] - bounds[i];
+		changes += size < 2 ? 0 : size - 1;
 	}
-
-	double threshold = 0.0;
-	if (!abs_changes.empty()) {
-		std::sort(abs_changes.begin(), abs_changes.end());
-		threshold = abs_changes[abs_changes.size() / 2]; // median
+	if (changes == 0) {
+		return 0.0;
 	}
-
-	std::string result;
-	double data_per_char = static_cast<double>(changes.size()) / width;
-
-	for (int i = 0; i < width; i++) {
-		int idx = static_cast<int>(i * data_per_char);
-		if (idx >= static_cast<int>(changes.size()))
-			idx = changes.size() - 1;
-
-		double change = changes[idx];
-		int level = 2; // default to same (middle)
-
-		if (change < -1e-10) {
-			level = (std::abs(change) > threshold) ? 0 : 1; // large down : small down
-		} else if (change > 1e-10) {
-			level = (std::abs(change) > threshold) ? 4 : 3; // large up : small up
+	magnitudes.resize(changes);
+	// Near-zero changes are written as 0, so they sort before all others and the median of the rest is
+	// selected past them
+	idx_t zeros = 0;
+	idx_t offset = 0;
+	for (idx_t i = 0; i < series_count; i++) {
+		const auto size = bounds[i + 1] - bounds[i];
+		if (size < 2) {
+			continue;
 		}
-
-		result += characters[level];
+		zeros += TextplotChangeMagnitudeKernel(data + bounds[i], size, magnitudes.data() + offset);
+		offset += size - 1;
 	}
-
-	return result;
+	if (zeros == changes) {
+		return 0.0;
+	}
+	const auto median = magnitudes.begin() + zeros + (changes - zeros) / 2;
+	std::nth_element(magnitudes.begin(), median, magnitudes.end());
+	return *median;
 }
 
 /**
- * Main sparkline generation function
+ * Generate sparkline showing trend with magnitude, changes larger than 'threshold' are drawn as large
  */
-std::string generateSparkline(const std::vector<double> &data, int width, const std::string &themeName,
-                              SparklineMode mode = SparklineMode::ABSOLUTE) {
-	if (data.empty())
-		return "";
+static void generateTrendSparkline(const double *data, idx_t size, idx_t width,
+                                   const std::vector<std::string> &characters, double threshold,
+                                   TextplotListLocalState &scratch, TextplotRender &result) {
+	if (size < 2 || width == 0 || characters.size() < 5)
+		return;
 
-	auto characters = EnhancedSparklineThemes::getTheme(themeName, mode);
+	auto &levels = scratch.levels;
+	levels.resize(width);
+	TextplotChangeLevelKernel(data, size, width, threshold, levels.data());
+	appendGlyphs(characters, levels.data(), width, result);
+}
 
-	switch (mode) {
+/**
+ * Main sparkline generation function, appends to 'result' using the buffers of 'scratch'. 'trend_threshold'
+ * replaces the threshold of the trend mode when given.
+ */
+static void generateSparkline(const TextplotSparklineBindData &bind_data, const double *data, idx_t size,
+                              const double *scale_min, const double *scale_max, const double *trend_threshold,
+                              TextplotListLocalState &scratch, TextplotRender &result) {
+	if (size == 0 || bind_data.width <= 0)
+		return;
+
+	const auto &characters = *bind_data.glyphs;
+	const auto width = static_cast<idx_t>(bind_data.width);
+	switch (bind_data.mode) {
 	case SparklineMode::DELTA:
-		return generateDeltaSparkline(data.data(), data.size(), width, characters);
-	case SparklineMode::TREND:
-		return generateTrendSparkline(data.data(), data.size(), width, characters);
+		generateDeltaSparkline(data, size, width, characters, scratch, result);
+		break;
+	case SparklineMode::TREND: {
+		const idx_t bounds[] = {0, size};
+		const auto threshold = trend_threshold ? *trend_threshold : trendThreshold(data, bounds, 1, scratch.work);
+		generateTrendSparkline(data, size, width, characters, threshold, scratch, result);
+		break;
+	}
 	case SparklineMode::ABSOLUTE:
 	default:
-		return generateAbsoluteSparkline(data.data(), data.size(), width, characters);
+		generateAbsoluteSparkline(data, size, width, characters, scale_min, scale_max, scratch, result);
+		break;
 	}
 }
 
-// Bar chart bind data structure
-struct TextplotSparklineBindData : public FunctionData {
-	SparklineMode mode = SparklineMode::ABSOLUTE;
-	string theme = "utf8_blocks";
+TextplotSparklineBindData::TextplotSparklineBindData(SparklineMode mode_p, string theme_p, int64_t width_p,
+                                                     TextplotScaleBound min_p, TextplotScaleBound max_p,
+                                                     idx_t max_samples_p)
+    : mode(mode_p), theme(std::move(theme_p)), width(width_p), min(min_p), max(max_p), max_samples(max_samples_p),
+      glyphs(&EnhancedSparklineThemes::getTheme(theme, mode)) {
+}
 
-	int64_t width = 10;
+const vector<string> &TextplotSparklineGlyphs(const TextplotSparklineBindData &bind_data) {
+	return *bind_data.glyphs;
+}
+
+void TextplotAppendAbsoluteSparkline(const vector<string> &characters, const double *prefix_sums, idx_t size,
+                                     idx_t width, double min_val, double max_val, TextplotListLocalState &scratch,
+                                     TextplotRender &result) {
+	if (size == 0 || width == 0 || characters.empty())
+		return;
 
-	TextplotSparklineBindData(SparklineMode mode_p, string theme_p, int64_t width_p)
-	    : mode(mode_p), theme(std::move(theme_p)), width(width_p) {
+	// Same buckets as TextplotBucketMeanKernel, each averaged in O(1) from the prefix sums
+	auto &means = scratch.work;
+	means.resize(width);
+	double data_per_char = static_cast<double>(size) / width;
+	for (idx_t i = 0; i < width; i++) {
+		idx_t start_idx = std::min(static_cast<idx_t>(i * data_per_char), size - 1);
+		idx_t end_idx = std::max(std::min(static_cast<idx_t>((i + 1) * data_per_char), size), start_idx + 1);
+		means[i] = (prefix_sums[end_idx] - prefix_sums[start_idx]) / (end_idx - start_idx);
 	}
 
-	unique_ptr<FunctionData> Copy() const override;
-	bool Equals(const FunctionData &other_p) const override;
+	appendAbsoluteLevels(means.data(), width, characters, min_val, max_val, scratch.levels, result);
+}
 
-private:
-};
+void TextplotAppendDeltaSparkline(const vector<string> &characters, const double *data, idx_t size, idx_t width,
+                                  TextplotListLocalState &scratch, TextplotRender &result) {
+	generateDeltaSparkline(data, size, width, characters, scratch, result);
+}
+
+void TextplotAppendTrendSparkline(const vector<string> &characters, const double *data, idx_t size, idx_t width,
+                                  double threshold, TextplotListLocalState &scratch, TextplotRender &result) {
+	generateTrendSparkline(data, size, width, characters, threshold, scratch, result);
+}
 
 unique_ptr<FunctionData> TextplotSparklineBindData::Copy() const {
-	return make_uniq<TextplotSparklineBindData>(mode, theme, width);
+	return make_uniq<TextplotSparklineBindData>(mode, theme, width, min, max, max_samples);
 }
 
 bool TextplotSparklineBindData::Equals(const FunctionData &other_p) const {
 	const auto &other = other_p.Cast<TextplotSparklineBindData>();
-	return mode == other.mode && theme == other.theme && width == other.width;
+	return multi_series == other.multi_series && mode == other.mode && theme == other.theme &&
+	       width == other.width && min == other.min && max == other.max && max_samples == other.max_samples;
 }
 
-unique_ptr<FunctionData> TextplotSparklineBind(ClientContext &context, ScalarFunction &bound_function,
-                                               vector<unique_ptr<Expression>> &arguments) {
-	if (arguments.empty()) {
-		throw BinderException("tp_sparkline takes at least one argument");
-	}
-
-	const auto &first_arg = arguments[0]->return_type;
-	if (!first_arg.IsNested() || first_arg.InternalType() != PhysicalType::LIST ||
-	    !ListType::GetChildType(first_arg).IsNumeric()) {
-		throw InvalidTypeException("tp_sparkline first argument must be a list of numeric values");
-	}
-
+unique_ptr<TextplotSparklineBindData> TextplotSparklineBindOptions(ClientContext &context,
+                                                                   const string &function_name,
+                                                                   vector<unique_ptr<Expression>> &arguments,
+                                                                   idx_t first_option, bool allow_row_bounds,
+                                                                   bool series_options) {
 	// Optional arguments
 	int64_t width = 20;
 	string theme = "";
 	string specified_mode = "absolute";
+	TextplotScaleBound min;
+	TextplotScaleBound max;
+	idx_t max_samples = 0;
 
-	for (idx_t i = 1; i < arguments.size(); i++) {
+	for (idx_t i = first_option; i < arguments.size(); i++) {
 		const auto &arg = arguments[i];
 		if (arg->HasParameter()) {
 			throw ParameterNotResolvedException();
 		}
+		const auto alias = arg->GetAlias();
+		if (series_options && (alias == "as_list" || alias == "labels")) {
+			continue;
+		}
+		if ((alias == "min" || alias == "max") && (allow_row_bounds || arg->IsFoldable())) {
+			// 'min' and 'max' may vary per row, e.g. to share one scale across a window partition
+			auto &bound = alias == "min" ? min : max;
+			bound = TextplotBindScaleBound(context, function_name, alias, arguments, i);
+			continue;
+		}
 		if (!arg->IsFoldable()) {
-			throw BinderException("tp_sparkline: arguments must be constant");
+			throw BinderException(StringUtil::Format("%s: arguments must be constant", function_name));
+		}
+		if (TextplotBindSampling(context, function_name, alias, *arg, max_samples)) {
+			continue;
 		}
-		const auto &alias = arg->GetAlias();
 		if (alias == "width") {
 			if (!arg->return_type.IsIntegral()) {
-				throw BinderException("tp_sparkline: 'width' argument must be an integer");
+				throw BinderException(StringUtil::Format("%s: 'width' argument must be an integer", function_name));
 			}
 			const auto eval_result = ExpressionExecutor::EvaluateScalar(context, *arg);
 			width = eval_result.CastAs(context, LogicalType::UBIGINT).GetValue<uint64_t>();
 		} else if (alias == "theme") {
 			if (arg->return_type.id() != LogicalTypeId::VARCHAR) {
-				throw BinderException("tp_sparkline: 'theme' argument must be a VARCHAR");
+				throw BinderException(StringUtil::Format("%s: 'theme' argument must be a VARCHAR", function_name));
 			}
 			theme = StringValue::Get(ExpressionExecutor::EvaluateScalar(context, *arg));
 		} else if (alias == "mode") {
 			if (arg->return_type.id() != LogicalTypeId::VARCHAR) {
-				throw BinderException("tp_sparkline: 'mode' argument must be a VARCHAR");
+				throw BinderException(StringUtil::Format("%s: 'mode' argument must be a VARCHAR", function_name));
 			}
 			specified_mode = StringValue::Get(ExpressionExecutor::EvaluateScalar(context, *arg));
 		} else {
-			throw BinderException(StringUtil::Format("tp_sparkline: Unknown argument '%s'", alias));
+			throw BinderException(StringUtil::Format("%s: Unknown argument '%s'", function_name, alias));
 		}
 	}
 
@@ -342,8 +362,8 @@ unique_ptr<FunctionData> TextplotSparklineBind(ClientContext &context, ScalarFun
 	} else if (specified_mode == "absolute") {
 		mode = SparklineMode::ABSOLUTE;
 	} else {
-		throw BinderException(StringUtil::Format(
-		    "tp_sparkline: Unknown type '%s' must be one of <delta, trend, absolute>", specified_mode));
+		throw BinderException(StringUtil::Format("%s: Unknown type '%s' must be one of <delta, trend, absolute>",
+		                                         function_name, specified_mode));
 	}
 
 	auto available_themes = EnhancedSparklineThemes::getAvailableThemes(mode);
@@ -360,43 +380,109 @@ unique_ptr<FunctionData> TextplotSparklineBind(ClientContext &context, ScalarFun
 		}
 	}
 	if (std::find(available_themes.begin(), available_themes.end(), theme) == available_themes.end()) {
-		throw BinderException(StringUtil::Format("tp_sparkline: Unknown theme '%s' for mode '%s', available are <%s>",
-		                                         theme, specified_mode, StringUtil::Join(available_themes, ", ")));
+		throw BinderException(StringUtil::Format("%s: Unknown theme '%s' for mode '%s', available are <%s>",
+		                                         function_name, theme, specified_mode,
+		                                         StringUtil::Join(available_themes, ", ")));
 	}
 
 	if (width < 1) {
-		throw BinderException("tp_sparkline: 'width' argument must be at least 1");
+		throw BinderException(StringUtil::Format("%s: 'width' argument must be at least 1", function_name));
 	}
 
-	return make_uniq<TextplotSparklineBindData>(mode, theme, width);
+	if ((min.is_set || max.is_set) && mode != SparklineMode::ABSOLUTE) {
+		throw BinderException(
+		    StringUtil::Format("%s: 'min' and 'max' arguments are only supported in 'absolute' mode", function_name));
+	}
+	if (min.IsConstant() && max.IsConstant() && min.value >= max.value) {
+		throw BinderException(StringUtil::Format("%s: 'min' must be less than 'max'", function_name));
+	}
+
+	return make_uniq<TextplotSparklineBindData>(mode, theme, width, min, max, max_samples);
 }
 
-void TextplotSparkline(DataChunk &args, ExpressionState &state, Vector &result) {
-	const auto &func_expr = state.expr.Cast<BoundFunctionExpression>();
-	const auto &bind_data = func_expr.bind_info->Cast<TextplotSparklineBindData>();
+unique_ptr<FunctionData> TextplotSparklineBind(ClientContext &context, ScalarFunction &bound_function,
+                                               vector<unique_ptr<Expression>> &arguments) {
+	if (arguments.empty()) {
+		throw BinderException("tp_sparkline takes at least one argument");
+	}
+
+	const auto &first_arg = arguments[0]->return_type;
+	if (first_arg.id() == LogicalTypeId::SQLNULL) {
+		bound_function.arguments[0] = LogicalType::LIST(LogicalType::DOUBLE);
+	} else {
+		const auto list_type = TextplotNumericListType(first_arg);
+		if (list_type.id() == LogicalTypeId::INVALID) {
+			// Several series at once
+			return TextplotSparklineSeriesBind(context, bound_function, arguments);
+		}
+		bound_function.arguments[0] = list_type;
+	}
 
-	auto &value_vector = args.data[0];
-	Vector input_data(LogicalType::LIST(LogicalType::DOUBLE));
-	VectorOperations::Cast(state.GetContext(), value_vector, input_data, args.size());
+	return TextplotSparklineBindOptions(context, "tp_sparkline", arguments, 1, true);
+}
 
-	auto &child_data = ListVector::GetEntry(input_data);
-	auto source_data = FlatVector::GetData<double>(child_data);
+string TextplotRenderSparkline(const TextplotSparklineBindData &bind_data, const double *data, idx_t size,
+                               const double *scale_min, const double *scale_max) {
+	TextplotRender result;
+	TextplotListLocalState scratch;
+	generateSparkline(bind_data, data, size, scale_min, scale_max, nullptr, scratch, result);
+	return result.ToString();
+}
 
-	UnaryExecutor::Execute<list_entry_t, string_t>(input_data, result, args.size(), [&](list_entry_t values) {
-		std::vector<double> data_items;
-		data_items.reserve(values.length);
+void TextplotAppendSparkline(const TextplotSparklineBindData &bind_data, const double *data, idx_t size,
+                             const double *scale_min, const double *scale_max, const double *trend_threshold,
+                             TextplotListLocalState &scratch, TextplotRender &result) {
+	generateSparkline(bind_data, data, size, scale_min, scale_max, trend_threshold, scratch, result);
+}
 
-		for (auto i = values.offset; i < values.offset + values.length; i++) {
-			data_items.push_back(source_data[i]);
-		}
+double TextplotSparklineTrendThreshold(const double *data, const idx_t *bounds, idx_t series_count,
+                                       vector<double> &magnitudes) {
+	return trendThreshold(data, bounds, series_count, magnitudes);
+}
 
-		if (data_items.empty() || bind_data.width <= 0) {
-			return StringVector::AddString(result, "");
+void TextplotSparkline(DataChunk &args, ExpressionState &state, Vector &result) {
+	const auto &func_expr = state.expr.Cast<BoundFunctionExpression>();
+	const auto &bind_data = func_expr.bind_info->Cast<TextplotSparklineBindData>();
+	if (bind_data.multi_series) {
+		TextplotSparklineSeries(args, state, result);
+		return;
+	}
+	auto &local_state = TextplotListLocalState::Get(state);
+	const auto count = args.size();
+	TextplotStatsScope stats(state, TextplotStatsFunction::SPARKLINE);
+
+	TextplotListReader list_reader(args.data[0], count, local_state.elements);
+	const TextplotScaleReader min_reader(bind_data.min, args);
+	const TextplotScaleReader max_reader(bind_data.max, args);
+
+	result.SetVectorType(VectorType::FLAT_VECTOR);
+	auto result_data = FlatVector::GetData<string_t>(result);
+	auto &output = local_state.output;
+	idx_t elements = 0;
+	for (idx_t row = 0; row < count; row++) {
+		if (!list_reader.RowIsValid(row) || min_reader.IsNull(row) || max_reader.IsNull(row)) {
+			FlatVector::SetNull(result, row, true);
+			continue;
 		}
+		double scale_min;
+		double scale_max;
+		const bool has_min = min_reader.Get(row, scale_min);
+		const bool has_max = max_reader.Get(row, scale_max);
+
+		idx_t length;
+		// Sampling keeps the list order and takes the center of each stride
+		const auto values = list_reader.GetSample(row, bind_data.max_samples, false, length);
+		elements += length;
+		output.Clear();
+		generateSparkline(bind_data, values, length, has_min ? &scale_min : nullptr, has_max ? &scale_max : nullptr,
+		                  nullptr, local_state, output);
+		result_data[row] = output.Write(result);
+	}
 
-		return StringVector::AddString(result,
-		                               generateSparkline(data_items, bind_data.width, bind_data.theme, bind_data.mode));
-	});
+	if (args.AllConstant()) {
+		result.SetVectorType(VectorType::CONSTANT_VECTOR);
+	}
+	stats.Record(result, count, elements);
 }
 
 } // namespace duckdb
@@ -0,0 +1,572 @@
+#include "textplot_sparkline.hpp"
+#include "textplot_kernels.hpp"
+#include "textplot_list.hpp"
+#include "textplot_render.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/function/aggregate_function.hpp"
+#include "duckdb/common/types/column/column_data_collection.hpp"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <set>
+
+namespace duckdb {
+
+// Bounded-size streaming time series used by tp_sparkline_agg.
+//
+// The first PENDING_CAPACITY (ts, value) pairs are kept exactly, so small groups render exactly like
+// tp_sparkline(list(value ORDER BY ts)). After that the values are summed into RESOLUTION equal-width
+// time buckets whose range doubles whenever a timestamp falls outside of it, the same way TextplotHistogram
+// grows. Buckets of two partial states are merged by their center, so the state is mergeable across threads
+// and never grows beyond RESOLUTION buckets.
+class TextplotSeries {
+public:
+	static constexpr idx_t RESOLUTION = 1024;
+	static constexpr idx_t PENDING_CAPACITY = RESOLUTION;
+
+	void Add(double ts, double value) {
+		if (!std::isfinite(ts) || !std::isfinite(value)) {
+			return;
+		}
+		if (count == 0) {
+			ts_min = ts_max = ts;
+		} else {
+			ts_min = std::min(ts_min, ts);
+			ts_max = std::max(ts_max, ts);
+		}
+		count++;
+
+		if (counts.empty()) {
+			pending.emplace_back(ts, value);
+			if (pending.size() > PENDING_CAPACITY) {
+				BuildGrid();
+			}
+			return;
+		}
+		AddToGrid(ts, value, 1);
+	}
+
+	void Combine(const TextplotSeries &other) {
+		if (other.count == 0) {
+			return;
+		}
+		if (other.counts.empty()) {
+			for (const auto &point : other.pending) {
+				Add(point.first, point.second);
+			}
+			return;
+		}
+		if (counts.empty()) {
+			// Adopt the buckets of the other side and add the pending points on top
+			auto points = std::move(pending);
+			pending = vector<std::pair<double, double>>();
+			counts = other.counts;
+			sums = other.sums;
+			lo = other.lo;
+			bucket_width = other.bucket_width;
+			ts_min = other.ts_min;
+			ts_max = other.ts_max;
+			count = other.count;
+			for (const auto &point : points) {
+				Add(point.first, point.second);
+			}
+			return;
+		}
+
+		// Both are bucketed, each bucket of the other side moves to the bucket of its center
+		for (idx_t i = 0; i < RESOLUTION; i++) {
+			if (other.counts[i] == 0) {
+				continue;
+			}
+			const auto center =
+			    std::min(std::max(other.lo + other.bucket_width * (i + 0.5), other.ts_min), other.ts_max);
+			AddToGrid(center, other.sums[i], other.counts[i]);
+		}
+		ts_min = std::min(ts_min, other.ts_min);
+		ts_max = std::max(ts_max, other.ts_max);
+		count += other.count;
+	}
+
+	idx_t Count() const {
+		return count;
+	}
+
+	// The values in timestamp order, or the mean of every non-empty bucket once the values are bucketed
+	vector<double> GetValues() {
+		vector<double> values;
+		if (counts.empty()) {
+			std::sort(pending.begin(), pending.end());
+			values.reserve(pending.size());
+			for (const auto &point : pending) {
+				values.push_back(point.second);
+			}
+			return values;
+		}
+		for (idx_t i = 0; i < RESOLUTION; i++) {
+			if (counts[i] > 0) {
+				values.push_back(sums[i] / counts[i]);
+			}
+		}
+		return values;
+	}
+
+private:
+	void BuildGrid() {
+		lo = ts_min;
+		double span = ts_max - ts_min;
+		if (span <= 0) {
+			span = std::max(std::abs(ts_min), 1.0) / RESOLUTION;
+		}
+		// The latest timestamp lands in the last bucket
+		bucket_width = span / (RESOLUTION - 1);
+		counts.assign(RESOLUTION, 0);
+		sums.assign(RESOLUTION, 0);
+		for (const auto &point : pending) {
+			const auto index = Index(point.first);
+			counts[index]++;
+			sums[index] += point.second;
+		}
+		pending.clear();
+		pending.shrink_to_fit();
+	}
+
+	idx_t Index(double ts) const {
+		const double position = (ts - lo) / bucket_width;
+		if (!(position >= 0)) {
+			return 0;
+		}
+		if (position >= static_cast<double>(RESOLUTION - 1)) {
+			return RESOLUTION - 1;
+		}
+		return static_cast<idx_t>(position);
+	}
+
+	void AddToGrid(double ts, double sum, idx_t n) {
+		while (ts < lo) {
+			Grow(true);
+		}
+		while (ts >= lo + bucket_width * RESOLUTION) {
+			Grow(false);
+		}
+		const auto index = Index(ts);
+		counts[index] += n;
+		sums[index] += sum;
+	}
+
+	// Doubles the time range by merging adjacent buckets in place, like TextplotHistogram::Grow
+	void Grow(bool downward) {
+		constexpr idx_t HALF = RESOLUTION / 2;
+		if (downward) {
+			for (idx_t i = RESOLUTION; i-- > HALF;) {
+				const auto source = 2 * (i - HALF);
+				counts[i] = counts[source] + counts[source + 1];
+				sums[i] = sums[source] + sums[source + 1];
+			}
+			std::fill(counts.begin(), counts.begin() + HALF, 0);
+			std::fill(sums.begin(), sums.begin() + HALF, 0);
+			lo -= bucket_width * RESOLUTION;
+		} else {
+			for (idx_t i = 0; i < HALF; i++) {
+				counts[i] = counts[2 * i] + counts[2 * i + 1];
+				sums[i] = sums[2 * i] + sums[2 * i + 1];
+			}
+			std::fill(counts.begin() + HALF, counts.end(), 0);
+			std::fill(sums.begin() + HALF, sums.end(), 0);
+		}
+		bucket_width *= 2;
+	}
+
+	idx_t count = 0;
+	double ts_min = 0;
+	double ts_max = 0;
+
+	// Exact (ts, value) pairs, only used until the buckets are built
+	vector<std::pair<double, double>> pending;
+
+	// Number and sum of the values per time bucket
+	vector<idx_t> counts;
+	vector<double> sums;
+	double lo = 0;
+	double bucket_width = 0;
+};
+
+// The rows of a window partition, prepared once so that each frame renders in O(width) instead of a pass
+// over the frame. Only rows with a finite value and timestamp are kept, in partition order.
+struct TextplotSparklinePartition {
+	vector<double> values;
+	vector<double> timestamps;
+	// prefix_sums[k] is the sum of the first k values
+	vector<double> prefix_sums;
+	// descents[k] counts the positions j < k whose (ts, value) sorts before the one at j - 1
+	vector<idx_t> descents;
+	// For every partition row, the number of kept rows and of non NULL rows before it
+	vector<idx_t> kept_before;
+	vector<idx_t> non_null_before;
+
+	// True if the kept rows [begin, end) are already in timestamp order, like the pending values of
+	// TextplotSeries are sorted
+	bool IsOrdered(idx_t begin, idx_t end) const {
+		return end - begin < 2 || descents[end] == descents[begin + 1];
+	}
+};
+
+// Per thread state of the window, follows the frame as it slides. The running minimum and maximum are kept
+// in monotonic deques, the median of the absolute changes for the trend mode in two multisets.
+struct TextplotSparklineCursor {
+	idx_t begin = 0;
+	idx_t end = 0;
+	std::deque<idx_t> min_queue;
+	std::deque<idx_t> max_queue;
+	// The smaller half of the absolute changes, and the larger half holding the median at its front
+	std::multiset<double> lower;
+	std::multiset<double> upper;
+
+	void Reset(idx_t position) {
+		begin = end = position;
+		min_queue.clear();
+		max_queue.clear();
+		lower.clear();
+		upper.clear();
+	}
+
+	void Move(const TextplotSparklinePartition &partition, const TextplotSparklineBindData &bind_data, idx_t new_begin,
+	          idx_t new_end) {
+		if (new_begin < begin || new_end < end || new_begin >= end) {
+			Reset(new_begin);
+		}
+		const auto &values = partition.values;
+		const bool track_extent = bind_data.mode == SparklineMode::ABSOLUTE;
+		const bool track_changes = bind_data.mode == SparklineMode::TREND;
+		for (; end < new_end; end++) {
+			if (track_extent) {
+				while (!min_queue.empty() && values[min_queue.back()] >= values[end]) {
+					min_queue.pop_back();
+				}
+				min_queue.push_back(end);
+				while (!max_queue.empty() && values[max_queue.back()] <= values[end]) {
+					max_queue.pop_back();
+				}
+				max_queue.push_back(end);
+			}
+			if (track_changes && end > begin) {
+				AddChange(values[end] - values[end - 1]);
+			}
+		}
+		for (; begin < new_begin; begin++) {
+			if (track_changes && begin + 1 < end) {
+				RemoveChange(values[begin + 1] - values[begin]);
+			}
+		}
+		while (!min_queue.empty() && min_queue.front() < begin) {
+			min_queue.pop_front();
+		}
+		while (!max_queue.empty() && max_queue.front() < begin) {
+			max_queue.pop_front();
+		}
+	}
+
+	// Same as the threshold of generateTrendSparkline, the element at index n / 2 of the sorted changes
+	double Threshold() const {
+		return upper.empty() ? 0.0 : *upper.begin();
+	}
+
+private:
+	void AddChange(double change) {
+		if (!(std::abs(change) > TEXTPLOT_CHANGE_EPSILON)) {
+			return;
+		}
+		const auto magnitude = std::abs(change);
+		if (!upper.empty() && magnitude >= *upper.begin()) {
+			upper.insert(magnitude);
+		} else {
+			lower.insert(magnitude);
+		}
+		Rebalance();
+	}
+
+	void RemoveChange(double change) {
+		if (!(std::abs(change) > TEXTPLOT_CHANGE_EPSILON)) {
+			return;
+		}
+		const auto magnitude = std::abs(change);
+		if (!lower.empty() && magnitude <= *lower.rbegin()) {
+			lower.erase(lower.find(magnitude));
+		} else {
+			upper.erase(upper.find(magnitude));
+		}
+		Rebalance();
+	}
+
+	void Rebalance() {
+		const auto half = (lower.size() + upper.size()) / 2;
+		while (lower.size() > half) {
+			upper.insert(*lower.rbegin());
+			lower.erase(std::prev(lower.end()));
+		}
+		while (lower.size() < half) {
+			lower.insert(*upper.begin());
+			upper.erase(upper.begin());
+		}
+	}
+};
+
+// Buffers of the window local state, reused from row to row
+struct TextplotSparklineWindowScratch {
+	// The rows of a frame that is not ordered by timestamp
+	vector<std::pair<double, double>> points;
+	// The values of those rows, the sparkline buffers and the plot of the current row
+	TextplotListLocalState list;
+};
+
+struct TextplotSparklineAggState {
+	TextplotSeries *series;
+	// Only used when evaluated as a window function
+	TextplotSparklinePartition *partition;
+	TextplotSparklineCursor *cursor;
+	TextplotSparklineWindowScratch *scratch;
+};
+
+struct TextplotSparklineAggOperation {
+	template <class STATE>
+	static void Initialize(STATE &state) {
+		state.series = nullptr;
+		state.partition = nullptr;
+		state.cursor = nullptr;
+		state.scratch = nullptr;
+	}
+
+	static TextplotSeries &GetSeries(TextplotSparklineAggState &state) {
+		if (!state.series) {
+			state.series = new TextplotSeries();
+		}
+		return *state.series;
+	}
+
+	template <class A_TYPE, class B_TYPE, class STATE, class OP>
+	static void Operation(STATE &state, const A_TYPE &value, const B_TYPE &ts, AggregateBinaryInput &binary_input) {
+		// Timestamps and dates are aggregated on their physical value, only the order matters
+		GetSeries(state).Add(static_cast<double>(ts), value);
+	}
+
+	template <class STATE, class OP>
+	static void Combine(const STATE &source, STATE &target, AggregateInputData &aggr_input_data) {
+		if (!source.series) {
+			return;
+		}
+		GetSeries(target).Combine(*source.series);
+	}
+
+	template <class T, class STATE>
+	static void Finalize(STATE &state, T &target, AggregateFinalizeData &finalize_data) {
+		if (!state.series) {
+			finalize_data.ReturnNull();
+			return;
+		}
+		const auto &bind_data = finalize_data.input.bind_data->Cast<TextplotSparklineBindData>();
+		const auto values = state.series->GetValues();
+		if (values.empty()) {
+			target = StringVector::AddString(finalize_data.result, "");
+			return;
+		}
+		const auto &min = bind_data.min;
+		const auto &max = bind_data.max;
+		target = StringVector::AddString(
+		    finalize_data.result,
+		    TextplotRenderSparkline(bind_data, values.data(), values.size(), min.is_set ? &min.value : nullptr,
+		                            max.is_set ? &max.value : nullptr));
+	}
+
+	template <class STATE>
+	static void Destroy(STATE &state, AggregateInputData &aggr_input_data) {
+		delete state.series;
+		state.series = nullptr;
+		delete state.partition;
+		state.partition = nullptr;
+		delete state.cursor;
+		state.cursor = nullptr;
+		delete state.scratch;
+		state.scratch = nullptr;
+	}
+
+	static bool IgnoreNull() {
+		return true;
+	}
+
+	template <class TS_TYPE>
+	static void WindowInit(AggregateInputData &aggr_input_data, const WindowPartitionInput &partition,
+	                       data_ptr_t g_state) {
+		auto &gstate = *reinterpret_cast<TextplotSparklineAggState *>(g_state);
+		gstate.partition = new TextplotSparklinePartition();
+		auto &data = *gstate.partition;
+		data.kept_before.reserve(partition.count + 1);
+		data.non_null_before.reserve(partition.count + 1);
+		data.prefix_sums.push_back(0);
+		data.descents.assign(2, 0);
+
+		idx_t row = 0;
+		idx_t non_null = 0;
+		for (auto &chunk : partition.inputs->Chunks(partition.column_ids)) {
+			UnifiedVectorFormat value_format;
+			UnifiedVectorFormat ts_format;
+			chunk.data[0].ToUnifiedFormat(chunk.size(), value_format);
+			chunk.data[1].ToUnifiedFormat(chunk.size(), ts_format);
+			const auto value_data = UnifiedVectorFormat::GetData<double>(value_format);
+			const auto ts_data = UnifiedVectorFormat::GetData<TS_TYPE>(ts_format);
+			for (idx_t i = 0; i < chunk.size(); i++, row++) {
+				data.kept_before.push_back(data.values.size());
+				data.non_null_before.push_back(non_null);
+				const auto value_index = value_format.sel->get_index(i);
+				const auto ts_index = ts_format.sel->get_index(i);
+				if (!partition.filter_mask.RowIsValid(row) || !value_format.validity.RowIsValid(value_index) ||
+				    !ts_format.validity.RowIsValid(ts_index)) {
+					continue;
+				}
+				non_null++;
+				const auto value = value_data[value_index];
+				const auto ts = static_cast<double>(ts_data[ts_index]);
+				if (!std::isfinite(value) || !std::isfinite(ts)) {
+					continue;
+				}
+				if (!data.values.empty()) {
+					const bool descent =
+					    std::make_pair(ts, value) < std::make_pair(data.timestamps.back(), data.values.back());
+					data.descents.push_back(data.descents.back() + descent);
+				}
+				data.values.push_back(value);
+				data.timestamps.push_back(ts);
+				data.prefix_sums.push_back(data.prefix_sums.back() + value);
+			}
+		}
+		data.kept_before.push_back(data.values.size());
+		data.non_null_before.push_back(non_null);
+	}
+
+	static void Window(AggregateInputData &aggr_input_data, const WindowPartitionInput &partition,
+	                   const_data_ptr_t g_state, data_ptr_t l_state, const SubFrames &frames, Vector &result,
+	                   idx_t rid) {
+		const auto &bind_data = aggr_input_data.bind_data->Cast<TextplotSparklineBindData>();
+		const auto &data = *reinterpret_cast<const TextplotSparklineAggState *>(g_state)->partition;
+		auto &lstate = *reinterpret_cast<TextplotSparklineAggState *>(l_state);
+		auto result_data = FlatVector::GetData<string_t>(result);
+
+		idx_t non_null = 0;
+		for (const auto &frame : frames) {
+			non_null += data.non_null_before[frame.end] - data.non_null_before[frame.start];
+		}
+		if (non_null == 0) {
+			FlatVector::SetNull(result, rid, true);
+			return;
+		}
+
+		if (!lstate.scratch) {
+			lstate.scratch = new TextplotSparklineWindowScratch();
+		}
+		auto &scratch = lstate.scratch->list;
+		auto &output = scratch.output;
+		output.Clear();
+
+		const auto begin = data.kept_before[frames[0].start];
+		const auto end = data.kept_before[frames[0].end];
+		if (frames.size() != 1 || !data.IsOrdered(begin, end)) {
+			// Excluded rows or a window order that differs from the timestamps, the rows of the frame are sorted
+			// by timestamp and rendered from every row like the ordered frames below
+			auto &points = lstate.scratch->points;
+			points.clear();
+			for (const auto &frame : frames) {
+				for (auto k = data.kept_before[frame.start]; k < data.kept_before[frame.end]; k++) {
+					points.emplace_back(data.timestamps[k], data.values[k]);
+				}
+			}
+			std::sort(points.begin(), points.end());
+			auto &values = scratch.elements;
+			values.clear();
+			for (const auto &point : points) {
+				values.push_back(point.second);
+			}
+			const auto &min = bind_data.min;
+			const auto &max = bind_data.max;
+			TextplotAppendSparkline(bind_data, values.data(), values.size(), min.is_set ? &min.value : nullptr,
+			                        max.is_set ? &max.value : nullptr, nullptr, scratch, output);
+			result_data[rid] = output.Write(result);
+			return;
+		}
+
+		if (!lstate.cursor) {
+			lstate.cursor = new TextplotSparklineCursor();
+		}
+		auto &cursor = *lstate.cursor;
+		cursor.Move(data, bind_data, begin, end);
+
+		const auto size = end - begin;
+		const auto width = static_cast<idx_t>(bind_data.width);
+		const auto &glyphs = TextplotSparklineGlyphs(bind_data);
+		switch (bind_data.mode) {
+		case SparklineMode::DELTA:
+			TextplotAppendDeltaSparkline(glyphs, data.values.data() + begin, size, width, scratch, output);
+			break;
+		case SparklineMode::TREND:
+			TextplotAppendTrendSparkline(glyphs, data.values.data() + begin, size, width, cursor.Threshold(), scratch,
+			                             output);
+			break;
+		case SparklineMode::ABSOLUTE:
+		default:
+			if (size > 0) {
+				auto min = bind_data.min.is_set ? bind_data.min.value : data.values[cursor.min_queue.front()];
+				auto max = bind_data.max.is_set ? bind_data.max.value : data.values[cursor.max_queue.front()];
+				TextplotClampOpenScale(bind_data.min.is_set, bind_data.max.is_set, min, max);
+				TextplotAppendAbsoluteSparkline(glyphs, data.prefix_sums.data() + begin, size, width, min, max, scratch,
+				                                output);
+			}
+			break;
+		}
+		result_data[rid] = output.Write(result);
+	}
+};
+
+static unique_ptr<FunctionData> TextplotSparklineAggBind(ClientContext &context, AggregateFunction &function,
+                                                         vector<unique_ptr<Expression>> &arguments) {
+	if (arguments.size() < 2) {
+		throw BinderException("tp_sparkline_agg takes at least two arguments");
+	}
+	if (!arguments[0]->return_type.IsNumeric()) {
+		throw InvalidTypeException("tp_sparkline_agg first argument must be numeric");
+	}
+
+	auto bind_data = TextplotSparklineBindOptions(context, "tp_sparkline_agg", arguments, 2, false);
+	if (bind_data->max_samples > 0) {
+		throw BinderException("tp_sparkline_agg: 'approx' and 'max_samples' are not supported, the aggregate state "
+		                      "is always bounded");
+	}
+
+	// The options are consumed here, only the value and the timestamp are aggregated
+	arguments.erase(arguments.begin() + 2, arguments.end());
+	function.varargs = LogicalType::INVALID;
+	return std::move(bind_data);
+}
+
+template <class TS_TYPE>
+static AggregateFunction TextplotSparklineAggFunction(const LogicalType &ts_type) {
+	auto function = AggregateFunction::BinaryAggregate<TextplotSparklineAggState, double, TS_TYPE, string_t,
+	                                                   TextplotSparklineAggOperation>(
+	    LogicalType::DOUBLE, ts_type, LogicalType::VARCHAR);
+	function.name = "tp_sparkline_agg";
+	function.bind = TextplotSparklineAggBind;
+	function.destructor = AggregateFunction::StateDestroy<TextplotSparklineAggState, TextplotSparklineAggOperation>;
+	function.window = TextplotSparklineAggOperation::Window;
+	function.window_init = TextplotSparklineAggOperation::WindowInit<TS_TYPE>;
+	function.varargs = LogicalType::ANY;
+	function.order_dependent = AggregateOrderDependent::NOT_ORDER_DEPENDENT;
+	return function;
+}
+
+AggregateFunctionSet TextplotSparklineAggFunctions() {
+	AggregateFunctionSet set("tp_sparkline_agg");
+	// The timestamp types are read as their physical integer representation
+	set.AddFunction(TextplotSparklineAggFunction<double>(LogicalType::DOUBLE));
+	set.AddFunction(TextplotSparklineAggFunction<int64_t>(LogicalType::TIMESTAMP));
+	set.AddFunction(TextplotSparklineAggFunction<int64_t>(LogicalType::TIMESTAMP_TZ));
+	set.AddFunction(TextplotSparklineAggFunction<int32_t>(LogicalType::DATE));
+	return set;
+}
+
+} // namespace duckdb
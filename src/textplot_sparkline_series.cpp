@@ -0,0 +1,304 @@
+#include "textplot_sparkline.hpp"
+#include "textplot_kernels.hpp"
+#include "textplot_list.hpp"
+#include "textplot_render.hpp"
+#include "textplot_scale.hpp"
+#include "textplot_stats.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/common/utf8proc_wrapper.hpp"
+#include "duckdb/function/scalar_function.hpp"
+#include "duckdb/planner/expression/bound_function_expression.hpp"
+#include "duckdb/execution/expression_executor.hpp"
+#include <limits>
+
+namespace duckdb {
+
+// Where the series of a multi-series tp_sparkline come from
+enum class SparklineSeriesKind : uint8_t {
+	LIST,  // LIST(LIST(number)), unlabeled
+	MAP,   // MAP(VARCHAR, LIST(number)), labeled by the keys
+	STRUCT // STRUCT of LIST(number) fields, labeled by the field names
+};
+
+struct TextplotSparklineSeriesBindData : public TextplotSparklineBindData {
+	SparklineSeriesKind kind;
+	// Field names of a STRUCT
+	vector<string> names;
+	// Return a LIST with one sparkline per series instead of one line per series
+	bool as_list;
+	// Start every sparkline of a MAP or STRUCT with its key, padded to the longest one
+	bool labels;
+
+	TextplotSparklineSeriesBindData(const TextplotSparklineBindData &options, SparklineSeriesKind kind_p,
+	                                vector<string> names_p, bool as_list_p, bool labels_p)
+	    : TextplotSparklineBindData(options.mode, options.theme, options.width, options.min, options.max,
+	                                options.max_samples),
+	      kind(kind_p), names(std::move(names_p)), as_list(as_list_p), labels(labels_p) {
+		multi_series = true;
+	}
+
+	unique_ptr<FunctionData> Copy() const override {
+		return make_uniq<TextplotSparklineSeriesBindData>(*this, kind, names, as_list, labels);
+	}
+
+	bool Equals(const FunctionData &other_p) const override {
+		if (!TextplotSparklineBindData::Equals(other_p)) {
+			return false;
+		}
+		const auto &other = other_p.Cast<TextplotSparklineSeriesBindData>();
+		return kind == other.kind && names == other.names && as_list == other.as_list && labels == other.labels;
+	}
+};
+
+// Reads the series of every row of the first argument, one TextplotListReader over the lists of all
+// series of a LIST or MAP, one per field of a STRUCT
+class SparklineSeriesReader {
+public:
+	SparklineSeriesReader(const TextplotSparklineSeriesBindData &bind_data_p, Vector &input, idx_t count,
+	                      vector<double> &scratch)
+	    : bind_data(bind_data_p) {
+		if (bind_data.kind == SparklineSeriesKind::STRUCT) {
+			// The fields are then read with the row numbers of the struct
+			input.Flatten(count);
+			input.ToUnifiedFormat(count, format);
+			for (auto &field : StructVector::GetEntries(input)) {
+				readers.push_back(make_uniq<TextplotListReader>(*field, count, scratch));
+			}
+			return;
+		}
+		input.ToUnifiedFormat(count, format);
+		entries = UnifiedVectorFormat::GetData<list_entry_t>(format);
+		const auto series_count = ListVector::GetListSize(input);
+		if (bind_data.kind == SparklineSeriesKind::MAP) {
+			MapVector::GetKeys(input).ToUnifiedFormat(series_count, key_format);
+			readers.push_back(make_uniq<TextplotListReader>(MapVector::GetValues(input), series_count, scratch));
+		} else {
+			readers.push_back(make_uniq<TextplotListReader>(ListVector::GetEntry(input), series_count, scratch));
+		}
+	}
+
+	bool RowIsValid(idx_t row) const {
+		return format.validity.RowIsValid(format.sel->get_index(row));
+	}
+
+	// Collects the series of a valid row into 'state', a NULL series is read as an empty one
+	void Read(idx_t row, TextplotListLocalState &state) {
+		state.series.clear();
+		state.series_bounds.assign(1, 0);
+		state.labels.clear();
+		if (bind_data.kind == SparklineSeriesKind::STRUCT) {
+			for (idx_t i = 0; i < readers.size(); i++) {
+				const auto &name = bind_data.names[i];
+				state.labels.emplace_back(name.c_str(), static_cast<uint32_t>(name.size()));
+				AppendSeries(*readers[i], row, state);
+			}
+			return;
+		}
+		const auto &entry = entries[format.sel->get_index(row)];
+		const auto keys = UnifiedVectorFormat::GetData<string_t>(key_format);
+		for (idx_t i = entry.offset; i < entry.offset + entry.length; i++) {
+			if (bind_data.kind == SparklineSeriesKind::MAP) {
+				state.labels.push_back(keys[key_format.sel->get_index(i)]);
+			}
+			AppendSeries(*readers[0], i, state);
+		}
+	}
+
+private:
+	void AppendSeries(TextplotListReader &reader, idx_t series_row, TextplotListLocalState &state) {
+		if (reader.RowIsValid(series_row)) {
+			idx_t length;
+			const auto values = reader.GetSample(series_row, bind_data.max_samples, false, length);
+			state.series.insert(state.series.end(), values, values + length);
+		}
+		state.series_bounds.push_back(state.series.size());
+	}
+
+	const TextplotSparklineSeriesBindData &bind_data;
+	UnifiedVectorFormat format;
+	const list_entry_t *entries = nullptr;
+	UnifiedVectorFormat key_format;
+	vector<unique_ptr<TextplotListReader>> readers;
+};
+
+// Terminal columns taken by a label
+static idx_t LabelWidth(const string_t &label) {
+	const auto data = label.GetData();
+	const auto size = label.GetSize();
+	idx_t width = 0;
+	for (idx_t pos = 0; pos < size; pos = Utf8Proc::NextGraphemeCluster(data, size, pos)) {
+		width += Utf8Proc::RenderWidth(data, size, pos);
+	}
+	return width;
+}
+
+static bool BindSeriesFlag(ClientContext &context, const Expression &arg, const string &alias) {
+	if (!arg.IsFoldable()) {
+		throw BinderException("tp_sparkline: arguments must be constant");
+	}
+	if (arg.return_type.id() != LogicalTypeId::BOOLEAN) {
+		throw BinderException(StringUtil::Format("tp_sparkline: '%s' argument must be a BOOLEAN", alias));
+	}
+	const auto value = ExpressionExecutor::EvaluateScalar(context, arg);
+	return !value.IsNull() && BooleanValue::Get(value);
+}
+
+unique_ptr<FunctionData> TextplotSparklineSeriesBind(ClientContext &context, ScalarFunction &bound_function,
+                                                     vector<unique_ptr<Expression>> &arguments) {
+	static constexpr const char *INVALID_TYPE = "tp_sparkline first argument must be a list of numeric values, a list "
+	                                            "of such lists, or a MAP or STRUCT of them";
+	const auto &type = arguments[0]->return_type;
+	SparklineSeriesKind kind;
+	vector<string> names;
+	// Every series is cast to a list type TextplotListReader reads, MAP keys to VARCHAR
+	switch (type.id()) {
+	case LogicalTypeId::LIST:
+	case LogicalTypeId::ARRAY: {
+		const auto &child_type =
+		    type.id() == LogicalTypeId::LIST ? ListType::GetChildType(type) : ArrayType::GetChildType(type);
+		const auto series_type = TextplotNumericListType(child_type);
+		if (series_type.id() == LogicalTypeId::INVALID) {
+			throw InvalidTypeException(INVALID_TYPE);
+		}
+		kind = SparklineSeriesKind::LIST;
+		bound_function.arguments[0] = LogicalType::LIST(series_type);
+		break;
+	}
+	case LogicalTypeId::MAP: {
+		const auto series_type = TextplotNumericListType(MapType::ValueType(type));
+		if (series_type.id() == LogicalTypeId::INVALID) {
+			throw InvalidTypeException(INVALID_TYPE);
+		}
+		kind = SparklineSeriesKind::MAP;
+		bound_function.arguments[0] = LogicalType::MAP(LogicalType::VARCHAR, series_type);
+		break;
+	}
+	case LogicalTypeId::STRUCT: {
+		child_list_t<LogicalType> fields;
+		for (const auto &field : StructType::GetChildTypes(type)) {
+			const auto series_type = TextplotNumericListType(field.second);
+			if (series_type.id() == LogicalTypeId::INVALID) {
+				throw InvalidTypeException(INVALID_TYPE);
+			}
+			fields.emplace_back(field.first, series_type);
+			names.push_back(field.first);
+		}
+		kind = SparklineSeriesKind::STRUCT;
+		bound_function.arguments[0] = LogicalType::STRUCT(std::move(fields));
+		break;
+	}
+	default:
+		throw InvalidTypeException(INVALID_TYPE);
+	}
+
+	// Options of the multi-series form, the rest binds like tp_sparkline. The arguments stay in place so
+	// that per-row min/max columns keep their index.
+	bool as_list = false;
+	bool labels = true;
+	for (idx_t i = 1; i < arguments.size(); i++) {
+		const auto alias = arguments[i]->GetAlias();
+		if (alias == "as_list") {
+			as_list = BindSeriesFlag(context, *arguments[i], alias);
+		} else if (alias == "labels") {
+			labels = BindSeriesFlag(context, *arguments[i], alias);
+		}
+	}
+
+	auto options = TextplotSparklineBindOptions(context, "tp_sparkline", arguments, 1, true, true);
+	// The only thing the options decide about the function itself, one VARCHAR or a LIST of them
+	bound_function.return_type = as_list ? LogicalType::LIST(LogicalType::VARCHAR) : LogicalType::VARCHAR;
+	return make_uniq<TextplotSparklineSeriesBindData>(*options, kind, std::move(names), as_list,
+	                                                  labels && kind != SparklineSeriesKind::LIST);
+}
+
+void TextplotSparklineSeries(DataChunk &args, ExpressionState &state, Vector &result) {
+	constexpr double INF = std::numeric_limits<double>::infinity();
+	const auto &func_expr = state.expr.Cast<BoundFunctionExpression>();
+	const auto &bind_data = func_expr.bind_info->Cast<TextplotSparklineSeriesBindData>();
+	auto &local_state = TextplotListLocalState::Get(state);
+	const auto count = args.size();
+	TextplotStatsScope stats(state, TextplotStatsFunction::SPARKLINE);
+
+	SparklineSeriesReader series_reader(bind_data, args.data[0], count, local_state.elements);
+	const TextplotScaleReader min_reader(bind_data.min, args);
+	const TextplotScaleReader max_reader(bind_data.max, args);
+
+	result.SetVectorType(VectorType::FLAT_VECTOR);
+	const auto &series = local_state.series;
+	const auto &bounds = local_state.series_bounds;
+	const auto &labels = local_state.labels;
+	auto &output = local_state.output;
+	idx_t list_size = 0;
+	idx_t elements = 0;
+	for (idx_t row = 0; row < count; row++) {
+		if (!series_reader.RowIsValid(row) || min_reader.IsNull(row) || max_reader.IsNull(row)) {
+			FlatVector::SetNull(result, row, true);
+			continue;
+		}
+		series_reader.Read(row, local_state);
+		const auto series_count = bounds.size() - 1;
+		elements += series.size();
+
+		// The shared scale, one pass over all series of the row
+		double scale_min;
+		double scale_max;
+		const bool has_min = min_reader.Get(row, scale_min);
+		const bool has_max = max_reader.Get(row, scale_max);
+		if (bind_data.mode == SparklineMode::ABSOLUTE && (!has_min || !has_max)) {
+			const auto extent = TextplotExtentKernel(series.data(), series.size(), -INF, INF);
+			scale_min = has_min ? scale_min : extent.min;
+			scale_max = has_max ? scale_max : extent.max;
+			TextplotClampOpenScale(has_min, has_max, scale_min, scale_max);
+		}
+		double threshold = 0;
+		if (bind_data.mode == SparklineMode::TREND) {
+			threshold = TextplotSparklineTrendThreshold(series.data(), bounds.data(), series_count, local_state.work);
+		}
+
+		idx_t label_width = 0;
+		if (bind_data.labels) {
+			for (const auto &label : labels) {
+				label_width = MaxValue(label_width, LabelWidth(label));
+			}
+		}
+		const auto append_series = [&](idx_t i) {
+			if (bind_data.labels) {
+				output.Append(labels[i].GetData(), labels[i].GetSize());
+				output.Append(" ", 1, label_width - LabelWidth(labels[i]) + 1);
+			}
+			TextplotAppendSparkline(bind_data, series.data() + bounds[i], bounds[i + 1] - bounds[i], &scale_min,
+			                        &scale_max, &threshold, local_state, output);
+		};
+
+		if (bind_data.as_list) {
+			ListVector::Reserve(result, list_size + series_count);
+			auto &child = ListVector::GetEntry(result);
+			auto child_data = FlatVector::GetData<string_t>(child);
+			for (idx_t i = 0; i < series_count; i++) {
+				output.Clear();
+				append_series(i);
+				child_data[list_size + i] = output.Write(child);
+			}
+			FlatVector::GetData<list_entry_t>(result)[row] = list_entry_t {list_size, series_count};
+			list_size += series_count;
+			ListVector::SetListSize(result, list_size);
+		} else {
+			// One line per series
+			output.Clear();
+			for (idx_t i = 0; i < series_count; i++) {
+				if (i > 0) {
+					output.Append("\n", 1);
+				}
+				append_series(i);
+			}
+			FlatVector::GetData<string_t>(result)[row] = output.Write(result);
+		}
+	}
+
+	if (args.AllConstant()) {
+		result.SetVectorType(VectorType::CONSTANT_VECTOR);
+	}
+	stats.Record(result, count, elements);
+}
+
+} // namespace duckdb
@@ -0,0 +1,256 @@
+#include "textplot_stats.hpp"
+#include "textplot_profile.hpp"
+#include "duckdb/common/atomic.hpp"
+#include "duckdb/common/mutex.hpp"
+#include "duckdb/main/client_context.hpp"
+#include "duckdb/main/query_profiler.hpp"
+#include <algorithm>
+#include <array>
+
+namespace duckdb {
+
+static constexpr idx_t TEXTPLOT_STATS_FUNCTIONS = static_cast<idx_t>(TextplotStatsFunction::COUNT);
+
+static const char *const TEXTPLOT_STATS_NAMES[TEXTPLOT_STATS_FUNCTIONS] = {
+    "tp_bar", "tp_density", "tp_sparkline", "tp_qr", "tp_qr_matrix", "tp_qr_render"};
+
+const char *TextplotStatsFunctionName(TextplotStatsFunction function) {
+	return TEXTPLOT_STATS_NAMES[static_cast<idx_t>(function)];
+}
+
+typedef std::array<TextplotStatsValues, TEXTPLOT_STATS_FUNCTIONS> textplot_stats_t;
+
+// The counters of one thread. Only the owning thread writes them, so an update is a relaxed load and store and
+// never contends; tp_stats() reads them concurrently.
+struct TextplotThreadCounters {
+	struct Counters {
+		atomic<idx_t> rows {0};
+		atomic<idx_t> elements {0};
+		atomic<idx_t> bytes {0};
+		atomic<idx_t> nanos {0};
+	};
+	Counters functions[TEXTPLOT_STATS_FUNCTIONS];
+
+	static void Increment(atomic<idx_t> &counter, idx_t amount) {
+		counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+	void Add(TextplotStatsFunction function, const TextplotStatsValues &values) {
+		auto &counters = functions[static_cast<idx_t>(function)];
+		Increment(counters.rows, values.rows);
+		Increment(counters.elements, values.elements);
+		Increment(counters.bytes, values.bytes);
+		Increment(counters.nanos, values.nanos);
+	}
+
+	void AddTo(textplot_stats_t &totals) const {
+		for (idx_t i = 0; i < TEXTPLOT_STATS_FUNCTIONS; i++) {
+			totals[i].rows += functions[i].rows.load(std::memory_order_relaxed);
+			totals[i].elements += functions[i].elements.load(std::memory_order_relaxed);
+			totals[i].bytes += functions[i].bytes.load(std::memory_order_relaxed);
+			totals[i].nanos += functions[i].nanos.load(std::memory_order_relaxed);
+		}
+	}
+};
+
+// All thread counters of the process. Threads register on their first measured chunk and fold their counters
+// into 'retired' when they exit, so the totals never go back.
+class TextplotStatsRegistry {
+public:
+	static TextplotStatsRegistry &Get() {
+		static TextplotStatsRegistry registry;
+		return registry;
+	}
+
+	void Register(TextplotThreadCounters &counters) {
+		lock_guard<mutex> guard(lock);
+		threads.push_back(&counters);
+	}
+
+	void Unregister(TextplotThreadCounters &counters) {
+		lock_guard<mutex> guard(lock);
+		counters.AddTo(retired);
+		threads.erase(std::find(threads.begin(), threads.end(), &counters));
+	}
+
+	// The counters since the last Reset
+	textplot_stats_t Snapshot() {
+		lock_guard<mutex> guard(lock);
+		auto totals = Totals();
+		for (idx_t i = 0; i < TEXTPLOT_STATS_FUNCTIONS; i++) {
+			totals[i].rows -= reset_at[i].rows;
+			totals[i].elements -= reset_at[i].elements;
+			totals[i].bytes -= reset_at[i].bytes;
+			totals[i].nanos -= reset_at[i].nanos;
+		}
+		return totals;
+	}
+
+	// Threads keep counting, the totals at this point are subtracted from later snapshots
+	void Reset() {
+		lock_guard<mutex> guard(lock);
+		reset_at = Totals();
+	}
+
+private:
+	textplot_stats_t Totals() const {
+		auto totals = retired;
+		for (auto counters : threads) {
+			counters->AddTo(totals);
+		}
+		return totals;
+	}
+
+	mutex lock;
+	vector<TextplotThreadCounters *> threads;
+	textplot_stats_t retired;
+	textplot_stats_t reset_at;
+};
+
+namespace {
+
+struct ThreadCountersHandle {
+	TextplotThreadCounters counters;
+
+	ThreadCountersHandle() {
+		TextplotStatsRegistry::Get().Register(counters);
+	}
+	~ThreadCountersHandle() {
+		TextplotStatsRegistry::Get().Unregister(counters);
+	}
+};
+
+} // namespace
+
+static TextplotThreadCounters &ThreadCounters() {
+	// Ensures the registry outlives the handles of all threads, the main thread's included
+	TextplotStatsRegistry::Get();
+	thread_local ThreadCountersHandle handle;
+	return handle.counters;
+}
+
+TextplotStatsScope::TextplotStatsScope(ExpressionState &state_p, TextplotStatsFunction function_p)
+    : state(state_p), function(function_p), enabled(true) {
+	auto &context = state.GetContext();
+	Value setting;
+	if (context.TryGetCurrentSetting("tp_stats_enabled", setting) && !setting.IsNull()) {
+		enabled = BooleanValue::Get(setting);
+	}
+	profiling = QueryProfiler::Get(context).IsEnabled();
+	if (enabled || profiling) {
+		start = std::chrono::steady_clock::now();
+	}
+}
+
+static void AddStringBytes(Vector &vector, idx_t count, idx_t &bytes) {
+	UnifiedVectorFormat format;
+	vector.ToUnifiedFormat(count, format);
+	const auto data = UnifiedVectorFormat::GetData<string_t>(format);
+	for (idx_t i = 0; i < count; i++) {
+		const auto idx = format.sel->get_index(i);
+		if (format.validity.RowIsValid(idx)) {
+			bytes += data[idx].GetSize();
+		}
+	}
+}
+
+void TextplotStatsScope::Record(Vector &result, idx_t count, idx_t elements) {
+	if (!enabled && !profiling) {
+		return;
+	}
+	TextplotStatsValues values;
+	values.elements = elements;
+	values.nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+	                   .count();
+
+	UnifiedVectorFormat format;
+	result.ToUnifiedFormat(count, format);
+	for (idx_t i = 0; i < count; i++) {
+		values.rows += format.validity.RowIsValid(format.sel->get_index(i));
+	}
+	if (result.GetType().id() == LogicalTypeId::LIST) {
+		// tp_sparkline with 'as_list', a line per list element
+		AddStringBytes(ListVector::GetEntry(result), ListVector::GetListSize(result), values.bytes);
+	} else {
+		AddStringBytes(result, count, values.bytes);
+	}
+
+	if (enabled) {
+		ThreadCounters().Add(function, values);
+	}
+	if (profiling) {
+		TextplotProfileState::Get(state.GetContext())
+		    .Record(state.expr, function, values, cache_hits, cache_misses);
+	}
+}
+
+struct TextplotStatsGlobalState : public GlobalTableFunctionState {
+	textplot_stats_t stats;
+	idx_t offset = 0;
+};
+
+static unique_ptr<FunctionData> TextplotStatsBind(ClientContext &context, TableFunctionBindInput &input,
+                                                  vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"function", "rows", "elements", "output_bytes", "time_ns"};
+	return_types = {LogicalType::VARCHAR, LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::UBIGINT,
+	                LogicalType::UBIGINT};
+	return make_uniq<TableFunctionData>();
+}
+
+static unique_ptr<GlobalTableFunctionState> TextplotStatsInit(ClientContext &context, TableFunctionInitInput &input) {
+	auto state = make_uniq<TextplotStatsGlobalState>();
+	state->stats = TextplotStatsRegistry::Get().Snapshot();
+	return std::move(state);
+}
+
+static void TextplotStatsScan(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &state = data_p.global_state->Cast<TextplotStatsGlobalState>();
+	idx_t count = 0;
+	for (; state.offset < TEXTPLOT_STATS_FUNCTIONS && count < STANDARD_VECTOR_SIZE; state.offset++, count++) {
+		const auto &values = state.stats[state.offset];
+		output.SetValue(0, count, Value(TEXTPLOT_STATS_NAMES[state.offset]));
+		output.SetValue(1, count, Value::UBIGINT(values.rows));
+		output.SetValue(2, count, Value::UBIGINT(values.elements));
+		output.SetValue(3, count, Value::UBIGINT(values.bytes));
+		output.SetValue(4, count, Value::UBIGINT(values.nanos));
+	}
+	output.SetCardinality(count);
+}
+
+TableFunction TextplotStatsTableFunction() {
+	return TableFunction("tp_stats", {}, TextplotStatsScan, TextplotStatsBind, TextplotStatsInit);
+}
+
+struct TextplotStatsResetGlobalState : public GlobalTableFunctionState {
+	bool done = false;
+};
+
+static unique_ptr<FunctionData> TextplotStatsResetBind(ClientContext &context, TableFunctionBindInput &input,
+                                                       vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"success"};
+	return_types = {LogicalType::BOOLEAN};
+	return make_uniq<TableFunctionData>();
+}
+
+static unique_ptr<GlobalTableFunctionState> TextplotStatsResetInit(ClientContext &context,
+                                                                   TableFunctionInitInput &input) {
+	return make_uniq<TextplotStatsResetGlobalState>();
+}
+
+static void TextplotStatsResetScan(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &state = data_p.global_state->Cast<TextplotStatsResetGlobalState>();
+	if (state.done) {
+		return;
+	}
+	TextplotStatsRegistry::Get().Reset();
+	state.done = true;
+	output.SetValue(0, 0, Value::BOOLEAN(true));
+	output.SetCardinality(1);
+}
+
+TableFunction TextplotStatsResetTableFunction() {
+	return TableFunction("tp_stats_reset", {}, TextplotStatsResetScan, TextplotStatsResetBind,
+	                     TextplotStatsResetInit);
+}
+
+} // namespace duckdb